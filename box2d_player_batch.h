@@ -0,0 +1,66 @@
+// C API for running lots of headless worlds at once, for automated tuning and bot/AI training. Build
+// with -DBOX2D_PLAYER_LIBRARY=ON to get it as a shared library, see README.md.
+//
+// Every world is independent and runs the same level. Steps go across every core, one world per thread
+// at a time. Nothing here is thread safe, call it all from one thread (policies are the exception, see
+// b2pmStepWithPolicy).
+#ifndef BOX2D_PLAYER_BATCH_H
+#define BOX2D_PLAYER_BATCH_H
+
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(B2PM_BUILD)
+    #define B2PM_API __declspec(dllexport)
+#elif defined(_WIN32)
+    #define B2PM_API __declspec(dllimport)
+#else
+    #define B2PM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Input bits, same as the input log
+#define B2PM_INPUT_LEFT 1u
+#define B2PM_INPUT_RIGHT 2u
+#define B2PM_INPUT_JUMP 4u
+#define B2PM_INPUT_FIRE 8u
+
+// Floats per world in an observation: position x, position y (meters, y down), velocity x, velocity y
+// (meters per second) and 1 if the player's on the ground, 0 if not
+#define B2PM_OBSERVATION_SIZE 5
+
+typedef struct b2pmBatch b2pmBatch;
+
+// Called from worker threads, any number at once (never for the same world at once). Returns input bits.
+typedef uint32_t b2pmPolicy(int world, const float* observation, void* context);
+
+// Null level path for the built in demo layout. Thread count 0 uses every core. Null if the worlds
+// couldn't all be created, Box2D caps how many can exist at once and that counts any other worlds in
+// the process, other batches included.
+B2PM_API b2pmBatch* b2pmCreateBatch(int worldCount, int threadCount, const char* levelPath);
+B2PM_API void b2pmDestroyBatch(b2pmBatch* batch);
+B2PM_API int b2pmGetWorldCount(const b2pmBatch* batch);
+
+// Sticks until it's changed. A world that isn't in the batch gets a warning and nothing else
+B2PM_API void b2pmSetInput(b2pmBatch* batch, int world, uint32_t inputBits);
+
+// Steps every world stepCount times with the inputs set
+B2PM_API void b2pmStep(b2pmBatch* batch, int stepCount);
+
+// Same, but policy picks every world's input before each of its steps
+B2PM_API void b2pmStepWithPolicy(b2pmBatch* batch, int stepCount, b2pmPolicy* policy, void* context);
+
+// Back to how it was when it was created. Same as b2pmSetInput for a world that isn't in the batch
+B2PM_API void b2pmResetWorld(b2pmBatch* batch, int world);
+
+// World count * B2PM_OBSERVATION_SIZE floats, world by world, or as many whole worlds as fit in capacity
+// floats. Returns how many floats were written, 0 for a null buffer.
+B2PM_API int b2pmGetObservations(const b2pmBatch* batch, float* observations, int capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,96 +1,611 @@
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <sys/resource.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+#endif
 #include "raylib.h"
+#include "rlgl.h"
 #include "box2d/box2d.h"
 #include "box2d/types.h"
+#define B2PM_BUILD // Exporting the C API, not importing it
+#include "box2d_player_batch.h"
 
-#define ENABLE_DEBUG // Comment or uncomment this line to enable or disable debugging features
+#define ENABLE_DEBUG // Comment or uncomment this line to compile debugging features in or out. F1 toggles them at runtime
+
+// Rulesets. Everything that decides how the simulation runs and feels lives in one of these, and the
+// build picks one with RULESET_SERVER or RULESET_CLIENT (see CMakeLists.txt), standard otherwise. It's
+// all constexpr, so the unit conversions and tuning fold straight into the code. Input logs only
+// replay the same under the ruleset they were recorded with.
+struct StandardRuleset {
+    static constexpr const char* NAME = "standard";
+    static constexpr float PPM = 100.0f; // Pixels per meter
+    static constexpr float TIME_STEP = 1.0f / 60.0f; // Time step for world step, 60hz
+    static constexpr int SUB_STEP = 4; // Sub step for world step
+    static constexpr float GRAVITY = 20.0f; // Meters per second squared, pointing down
+    static constexpr float PLAYER_SIZE = 60.0f; // Player box, pixels per side
+    static constexpr float PLAYER_FRICTION = 0.40f;
+    static constexpr float PLAYER_LINEAR_DAMPING = 8.0f;
+    static constexpr float PLAYER_MOVE_IMPULSE = 0.50f; // Sideways impulse per step, times the player's mass
+    static constexpr float PLAYER_JUMP_IMPULSE = 10.0f; // Upwards impulse for a jump, times the player's mass
+    static constexpr float FOOT_SENSOR_HALF_SIZE = 10.0f; // Pixels
+    static constexpr float PLATFORM_FRICTION = 0.50f; // Default for platforms that don't set their own
+};
+
+// Dedicated server, half the substeps so more worlds fit on a core
+struct ServerRuleset : StandardRuleset {
+    static constexpr const char* NAME = "server";
+    static constexpr int SUB_STEP = 2;
+};
+
+// High fidelity client, 120hz with more substeps. Move impulses land twice as often, so they're halved
+struct ClientRuleset : StandardRuleset {
+    static constexpr const char* NAME = "client";
+    static constexpr float TIME_STEP = 1.0f / 120.0f;
+    static constexpr int SUB_STEP = 8;
+    static constexpr float PLAYER_MOVE_IMPULSE = StandardRuleset::PLAYER_MOVE_IMPULSE / 2.0f;
+};
+
+#if defined(RULESET_SERVER)
+    using Ruleset = ServerRuleset;
+#elif defined(RULESET_CLIENT)
+    using Ruleset = ClientRuleset;
+#else
+    using Ruleset = StandardRuleset;
+#endif
+
+constexpr const char* RULESET_NAME = Ruleset::NAME;
+constexpr float PPM = Ruleset::PPM;
+constexpr float TIME_STEP = Ruleset::TIME_STEP;
+constexpr int SUB_STEP = Ruleset::SUB_STEP;
+constexpr float GRAVITY = Ruleset::GRAVITY;
+constexpr float PLAYER_SIZE = Ruleset::PLAYER_SIZE;
+constexpr float PLAYER_FRICTION = Ruleset::PLAYER_FRICTION;
+constexpr float PLAYER_LINEAR_DAMPING = Ruleset::PLAYER_LINEAR_DAMPING;
+constexpr float PLAYER_MOVE_IMPULSE = Ruleset::PLAYER_MOVE_IMPULSE;
+constexpr float PLAYER_JUMP_IMPULSE = Ruleset::PLAYER_JUMP_IMPULSE;
+constexpr float FOOT_SENSOR_HALF_SIZE = Ruleset::FOOT_SENSOR_HALF_SIZE;
+constexpr float DEFAULT_PLATFORM_FRICTION = Ruleset::PLATFORM_FRICTION;
+constexpr uint64_t CHARACTER_CATEGORY = 1u << 1; // Shape filter bit for players and bots, triggers see it and foot sensors don't
 
 constexpr int WINDOW_WIDTH = 640;
 constexpr int WINDOW_HEIGHT = 480;
-constexpr float PPM = 100.0f; // Pixels per meter
-constexpr float TIME_STEP = 1.0f / 60.0f; // Time step for world step, 60hz
-constexpr int SUB_STEP = 4; // Sub step for world step
+constexpr int MAX_STEPS_PER_FRAME = 5; // Cap on world steps per frame so a slow frame can't snowball
+constexpr int TARGET_FPS = 60; // Render rate only, physics always runs at TIME_STEP. 0 for uncapped
+constexpr float CHUNK_WIDTH = WINDOW_WIDTH; // Width of a level streaming chunk in pixels
+constexpr int CHUNK_LOAD_RADIUS = 1; // Chunks either side of the player that get bodies created/enabled
+constexpr int CHUNK_PREFETCH_RADIUS = 2; // Chunks get handed to the worker thread for prep this far out
+constexpr int CHUNK_KEEP_RADIUS = 2; // Past this chunks get disabled, a bit wider than load so we don't thrash
+constexpr int CHUNK_DESTROY_RADIUS = 4; // Past this disabled chunks have their bodies destroyed
+constexpr int MAX_WORKER_COUNT = 64; // Box2D's own limit on workers
+constexpr int MAX_SCHEDULER_TASKS = 128; // Tasks in flight per world step before the scheduler runs them inline
+constexpr int MAX_BATCH_WORLDS = 128; // Box2D's B2_MAX_WORLDS, worlds that can exist at once in one process
+constexpr int MAX_PROJECTILES = 4096; // Projectile pool slots, spawns past this fail
+constexpr float PROJECTILE_SIZE = 12.0f; // Pixels per side
+constexpr float PROJECTILE_SPEED = 12.0f; // Meters per second, on top of the shooter's own velocity
+constexpr uint32_t PROJECTILE_LIFETIME = 120; // World steps before a projectile despawns
 constexpr Color DEBUG_COLOR = {0, 0, 255, 255}; // Color used to draw debugging shapes
+constexpr int MAX_DEBUG_LINES = 65536; // Debug overlay line buffer, allocated once. Anything past this gets dropped
+constexpr int MAX_DEBUG_TEXT_LINES = 8; // Lines in the cached debug text panel
+constexpr int DEBUG_TEXT_SIZE = 15; // Font size for the debug text panel
+constexpr const char* SPRITE_ATLAS_PATH = "Images/atlas.png"; // Optional art, see SpriteAtlas
+constexpr int SPRITE_CELL_SIZE = 32; // Pixels per side of an atlas cell
+constexpr int PLAYER_RUN_FRAMES = 4; // Frames in the run cycle
+constexpr float PLAYER_RUN_STRIDE = 8.0f; // Pixels moved per run frame
+constexpr float PLAYER_IDLE_SPEED = 0.1f; // Meters per second, slower than this sideways draws the idle frame
+constexpr int PROFILER_HISTORY = 240; // Frames kept for the profiler HUD's graph
+constexpr float PROFILER_GRAPH_MS = 33.3f; // Frame time at the top of the graph
+constexpr int MAX_TRACE_ZONES = 65536; // Trace ring buffer, the oldest zones get overwritten
+constexpr const char* TRACE_PATH = "trace.json"; // Where F3 writes the trace
+constexpr double LOW_LATENCY_MARGIN = 0.001; // Seconds of slack before a frame's due with --low-latency, covers sleep overshoot
+constexpr std::size_t LATENCY_SAMPLES = 3600; // Frames of input to present latency kept for the report at exit
+constexpr double TUNING_POLL_INTERVAL = 0.5; // Seconds between looks at the --tuning file
+constexpr double LOAD_SLICE = 0.004; // Seconds of main thread time loading gets per frame, see GameLoader
+constexpr float PLATFORM_GRID_CELL_SIZE = 128.0f; // Pixels per side of a PlatformGrid cell
+constexpr int BENCH_WARMUP_FRAMES = 60; // Frames each --bench-suite scene runs before anything's measured
+constexpr double BENCH_TOLERANCE = 0.2; // How much worse than its baseline a --bench-suite metric can get before it fails
+constexpr double BENCH_TIME_SLACK = 0.05; // Milliseconds on top of that, so timings near zero don't fail on noise
+constexpr double BENCH_ALLOCATION_SLACK = 0.5; // Same for allocations per frame, one new allocation every frame still fails
+constexpr float BENCH_TRIGGER_SIZE = 24.0f; // Pixels per side of a --bench-suite trigger
+constexpr uint16_t NET_DEFAULT_PORT = 27015; // UDP port for --server and --connect
+constexpr int NET_MAX_CONNECTIONS = 512; // Server ignores new addresses past this
+constexpr int NET_MAX_PACKET = 65507; // Biggest UDP payload, also the receive buffer size
+constexpr uint32_t NET_STATE_HISTORY = 32; // Ticks of state kept on both ends as delta baselines, about half a second at 60hz
+constexpr uint32_t NET_INPUT_REDUNDANCY = 8; // Inputs repeated in every client packet, covers that many lost in a row
+constexpr std::size_t NET_INPUT_BUFFER = 4; // Server drops a client's oldest queued inputs past this, caps added latency
+constexpr uint32_t NET_PREDICTION_HISTORY = 64; // Predicted steps the client keeps to reconcile against
+constexpr uint32_t NET_TIMEOUT_TICKS = 300; // Server stops sending to a client it hasn't heard from in this long
+constexpr float NET_POSITION_SCALE = 512.0f; // Quantization steps per meter, about a fifth of a pixel
+constexpr float NET_VELOCITY_SCALE = 256.0f; // Quantization steps per meter per second
+constexpr int32_t NET_RECONCILE_TOLERANCE = 2; // Quantization steps of prediction error before the client corrects
+
+// Strongly typed 2D vectors. Meters are what Box2D works in and Pixels are what gets drawn, and the only
+// way from one to the other is toPixels/toMeters, so a missed conversion is a compile error instead of
+// something drawn a hundred times too small. asMeters/asB2 and asPixels/asVector2 just relabel the
+// library types, no scaling.
+template <typename Unit>
+struct UnitVec2 {
+    float x;
+    float y;
+};
+
+struct MeterUnit {};
+struct PixelUnit {};
+using Meters = UnitVec2<MeterUnit>;
+using Pixels = UnitVec2<PixelUnit>;
+
+template <typename Unit>
+constexpr UnitVec2<Unit> operator+(const UnitVec2<Unit> a, const UnitVec2<Unit> b) {
+    return {a.x + b.x, a.y + b.y};
+}
+
+template <typename Unit>
+constexpr UnitVec2<Unit> operator-(const UnitVec2<Unit> a, const UnitVec2<Unit> b) {
+    return {a.x - b.x, a.y - b.y};
+}
+
+template <typename Unit>
+constexpr UnitVec2<Unit> operator*(const UnitVec2<Unit> v, const float s) {
+    return {v.x * s, v.y * s};
+}
+
+template <typename Unit>
+constexpr UnitVec2<Unit> operator/(const UnitVec2<Unit> v, const float s) {
+    return {v.x / s, v.y / s};
+}
+
+// t of 0 is from, 1 is to
+template <typename Unit>
+constexpr UnitVec2<Unit> interpolate(const UnitVec2<Unit> from, const UnitVec2<Unit> to, const float t) {
+    return from + (to - from) * t;
+}
+
+constexpr Pixels toPixels(const Meters m) {
+    return {m.x * PPM, m.y * PPM};
+}
+
+constexpr Meters toMeters(const Pixels p) {
+    return {p.x / PPM, p.y / PPM};
+}
+
+constexpr Meters asMeters(const b2Vec2 v) {
+    return {v.x, v.y};
+}
+
+constexpr b2Vec2 asB2(const Meters m) {
+    return {m.x, m.y};
+}
 
-class BoxBody;
-void drawDebugBodyPolygons(const BoxBody& targetBody);
-void drawDebugBodyCenter(const BoxBody& targetBody);
+constexpr Pixels asPixels(const Vector2 v) {
+    return {v.x, v.y};
+}
 
-// Convert meters to pixels using a b2Vec2
-Vector2 m2PxVec(const b2Vec2 vec) {
-    return Vector2{vec.x * PPM, vec.y * PPM};
+constexpr Vector2 asVector2(const Pixels p) {
+    return {p.x, p.y};
 }
 
-// Convert pixels to meters using a Vector2
-b2Vec2 px2MVec(const Vector2 vec) {
-    return b2Vec2{vec.x / PPM, vec.y / PPM};
+static_assert(toPixels(Meters{1.0f, 0.5f}).y == PPM / 2.0f, "Unit conversions should fold at compile time");
+
+// True if a box centered on center touches bounds
+constexpr bool overlaps(const b2AABB bounds, const Meters center, const Meters halfSize) {
+    return center.x + halfSize.x >= bounds.lowerBound.x && center.x - halfSize.x <= bounds.upperBound.x &&
+           center.y + halfSize.y >= bounds.lowerBound.y && center.y - halfSize.y <= bounds.upperBound.y;
 }
 
 // Convert meters to pixels using a float
-float m2Px(const float n) {
+constexpr float m2Px(const float n) {
     return n * PPM;
 }
 
 // Convert pixels to meters using a float
-float px2M(const float n) {
+constexpr float px2M(const float n) {
     return n / PPM;
 }
 
-// Sloppy comparison function since the == operator doesn't work on b2ShapeID
-// Remove if better fix is found later
-bool isShapeIdEqual(const b2ShapeId& idOne, const b2ShapeId& idTwo) {
-    return idOne.generation == idTwo.generation &&
-            idOne.index1 == idTwo.index1 &&
-            idOne.world0 == idTwo.world0;
+// Colors ride along in a shape's user data, packed into the pointer itself
+void* packColor(const Color color) {
+    const uintptr_t packed =
+        static_cast<uintptr_t>(color.r) << 24 |
+        static_cast<uintptr_t>(color.g) << 16 |
+        static_cast<uintptr_t>(color.b) << 8 |
+        static_cast<uintptr_t>(color.a);
+    return reinterpret_cast<void*>(packed);
+}
+
+Color unpackColor(const void* userData) {
+    const uintptr_t packed = reinterpret_cast<uintptr_t>(userData);
+    return Color{
+        static_cast<unsigned char>(packed >> 24),
+        static_cast<unsigned char>(packed >> 16),
+        static_cast<unsigned char>(packed >> 8),
+        static_cast<unsigned char>(packed)};
+}
+
+// Move-only owner of a Box2D id. Destroys it exactly once, when the owner goes away or gets reset, and
+// skips that if it's already gone (its body or world was destroyed first). It's the same size as the
+// id, so moving one around in a container is an 8 byte copy.
+template <typename Id, bool (*IsValid)(Id), void (*Destroy)(Id)>
+class OwnedId {
+    Id m_id{};
+public:
+    OwnedId() = default;
+
+    explicit OwnedId(const Id id) :
+        m_id(id)
+    {}
+
+    ~OwnedId() {
+        reset();
+    }
+
+    OwnedId(const OwnedId&) = delete;
+    OwnedId& operator=(const OwnedId&) = delete;
+
+    OwnedId(OwnedId&& other) noexcept :
+        m_id(other.release())
+    {}
+
+    OwnedId& operator=(OwnedId&& other) noexcept {
+        if (this != &other) {
+            reset();
+            m_id = other.release();
+        }
+        return *this;
+    }
+
+    void reset() {
+        if (B2_IS_NON_NULL(m_id) && IsValid(m_id)) {
+            Destroy(m_id);
+        }
+        m_id = Id{};
+    }
+
+    // Hands the id back without destroying it
+    Id release() {
+        const Id id = m_id;
+        m_id = Id{};
+        return id;
+    }
+
+    Id get() const {
+        return m_id;
+    }
+};
+
+inline void destroyShape(const b2ShapeId shape) {
+    b2DestroyShape(shape, true);
+}
+
+using WorldHandle = OwnedId<b2WorldId, b2World_IsValid, b2DestroyWorld>;
+using BodyHandle = OwnedId<b2BodyId, b2Body_IsValid, b2DestroyBody>;
+using ShapeHandle = OwnedId<b2ShapeId, b2Shape_IsValid, destroyShape>;
+
+// What a snapshot keeps for one dynamic body. Box2D's contact cache and sleep timers aren't reachable
+// from outside, so a restored body starts its next step without warm starting, which is close to the
+// original run but not bit for bit the same.
+struct BodyState {
+    b2Transform transform;
+    b2Vec2 linearVelocity;
+    float angularVelocity;
+    bool awake;
+};
+
+BodyState saveBodyState(const b2BodyId body) {
+    return {
+        b2Body_GetTransform(body),
+        b2Body_GetLinearVelocity(body),
+        b2Body_GetAngularVelocity(body),
+        b2Body_IsAwake(body)};
+}
+
+// Setting the transform doesn't send a move event, whoever caches positions has to restore those too
+void restoreBodyState(const b2BodyId body, const BodyState& state) {
+    b2Body_SetTransform(body, state.transform.p, state.transform.q);
+    b2Body_SetLinearVelocity(body, state.linearVelocity);
+    b2Body_SetAngularVelocity(body, state.angularVelocity);
+    b2Body_SetAwake(body, state.awake);
+}
+
+// How many shapes a sensor is overlapping as of the last step, from Box2D itself rather than from
+// events. Tops out at the buffer size, callers only care whether it's zero.
+int countSensorOverlaps(const b2ShapeId sensor) {
+    constexpr int capacity = 16;
+    b2ShapeId overlaps[capacity];
+    return b2Shape_GetSensorOverlaps(sensor, overlaps, capacity);
+}
+
+// Maps sensor shapes to whoever cares about them. Keyed on the packed shape id, generation included,
+// so every sensor event is one hash lookup no matter how many sensors are registered, and a stale
+// event for a destroyed shape just doesn't match anything.
+class SensorRegistry {
+public:
+    // Visitor is the shape that entered/left the sensor, began is false for end touch events
+    using Handler = std::function<void(b2ShapeId visitor, bool began)>;
+private:
+    std::unordered_map<uint64_t, Handler> m_handlers{};
+public:
+    void add(const b2ShapeId sensor, Handler handler) {
+        m_handlers[b2StoreShapeId(sensor)] = std::move(handler);
+    }
+
+    void remove(const b2ShapeId sensor) {
+        m_handlers.erase(b2StoreShapeId(sensor));
+    }
+
+    // One pass over the world's sensor events covers every registered sensor
+    void dispatch(const b2WorldId world) const {
+        const b2SensorEvents events = b2World_GetSensorEvents(world);
+
+        for (int i = 0; i < events.beginCount; i++) {
+            const b2SensorBeginTouchEvent& event = events.beginEvents[i];
+            const auto handler = m_handlers.find(b2StoreShapeId(event.sensorShapeId));
+            if (handler != m_handlers.end()) {
+                handler->second(event.visitorShapeId, true);
+            }
+        }
+
+        for (int i = 0; i < events.endCount; i++) {
+            const b2SensorEndTouchEvent& event = events.endEvents[i];
+            const auto handler = m_handlers.find(b2StoreShapeId(event.sensorShapeId));
+            if (handler != m_handlers.end()) {
+                handler->second(event.visitorShapeId, false);
+            }
+        }
+    }
+};
+
+// Where things are in the sprite atlas. The atlas is one row of SPRITE_CELL_SIZE square cells in this
+// order, so custom art only has to keep the layout. The built in art is white and gets tinted, so
+// everything keeps the colors it had before there was an atlas.
+enum SpriteRegion : uint8_t {
+    SPRITE_PLATFORM,
+    SPRITE_PROJECTILE,
+    SPRITE_PLAYER_IDLE,
+    SPRITE_PLAYER_JUMP,
+    SPRITE_PLAYER_RUN, // PLAYER_RUN_FRAMES cells from here
+    SPRITE_REGION_COUNT = SPRITE_PLAYER_RUN + PLAYER_RUN_FRAMES
+};
+
+// Draw order, back to front
+enum SpriteLayer : uint8_t {
+    LAYER_PLATFORMS,
+    LAYER_PROJECTILES,
+    LAYER_BOTS,
+    LAYER_PLAYER,
+    LAYER_COUNT
+};
+
+// Idle, run or jump frame. Run frames go by how far the player's gone instead of time, so the feet
+// don't slide at low speed, and a replay or rollback draws the same frames every time
+SpriteRegion playerFrame(const float pixelX, const bool moving, const bool onGround) {
+    if (!onGround) return SPRITE_PLAYER_JUMP;
+    if (!moving) return SPRITE_PLAYER_IDLE;
+
+    const int frame = static_cast<int>(std::floor(pixelX / PLAYER_RUN_STRIDE)) % PLAYER_RUN_FRAMES;
+    return static_cast<SpriteRegion>(SPRITE_PLAYER_RUN + (frame + PLAYER_RUN_FRAMES) % PLAYER_RUN_FRAMES);
 }
 
-// Base object class
+// The one texture every sprite comes out of. It's loaded on first use, so headless runs never need a
+// GL context, and SPRITE_ATLAS_PATH is optional: without it the built in art gets generated.
+class SpriteAtlas {
+    Texture2D m_texture{};
+
+    static Image generate() {
+        constexpr int cell = SPRITE_CELL_SIZE;
+        constexpr Color edge = {200, 200, 200, 255};
+        constexpr Color detail = {40, 40, 40, 255};
+        Image image = GenImageColor(cell * SPRITE_REGION_COUNT, cell, BLANK);
+
+        // Darker right and bottom edge so the seams between platform tiles show
+        ImageDrawRectangle(&image, SPRITE_PLATFORM * cell, 0, cell, cell, WHITE);
+        ImageDrawRectangle(&image, SPRITE_PLATFORM * cell + cell - 2, 0, 2, cell, edge);
+        ImageDrawRectangle(&image, SPRITE_PLATFORM * cell, cell - 2, cell, 2, edge);
+
+        ImageDrawRectangle(&image, SPRITE_PROJECTILE * cell, 0, cell, cell, WHITE);
+
+        // Player frames face right: body, eyes, and two legs that swing through the run cycle
+        constexpr int legSwing[PLAYER_RUN_FRAMES] = {-4, 0, 4, 0};
+        for (int region = SPRITE_PLAYER_IDLE; region < SPRITE_REGION_COUNT; region++) {
+            const int x = region * cell;
+            ImageDrawRectangle(&image, x, 0, cell, cell - 8, WHITE);
+            ImageDrawRectangle(&image, x + 17, 7, 4, 6, detail);
+            ImageDrawRectangle(&image, x + 25, 7, 4, 6, detail);
+
+            if (region == SPRITE_PLAYER_JUMP) {
+                ImageDrawRectangle(&image, x + 3, cell - 8, 8, 4, WHITE);
+                ImageDrawRectangle(&image, x + 21, cell - 8, 8, 4, WHITE);
+            }
+            else {
+                const int swing = region == SPRITE_PLAYER_IDLE ? 0 : legSwing[region - SPRITE_PLAYER_RUN];
+                ImageDrawRectangle(&image, x + 5 - swing, cell - 8, 6, 8, WHITE);
+                ImageDrawRectangle(&image, x + 21 + swing, cell - 8, 6, 8, WHITE);
+            }
+        }
+
+        return image;
+    }
+
+public:
+    SpriteAtlas() = default;
+    SpriteAtlas(const SpriteAtlas&) = delete;
+    SpriteAtlas& operator=(const SpriteAtlas&) = delete;
+
+    // CPU side only, so it's fine off the main thread
+    static Image decode() {
+        Image image = FileExists(SPRITE_ATLAS_PATH) ? LoadImage(SPRITE_ATLAS_PATH) : generate();
+        if (image.width < SPRITE_CELL_SIZE * SPRITE_REGION_COUNT || image.height < SPRITE_CELL_SIZE) {
+            TraceLog(LOG_WARNING, "%s doesn't fit the atlas layout, using the built in art.", SPRITE_ATLAS_PATH);
+            UnloadImage(image);
+            image = generate();
+        }
+        return image;
+    }
+
+    // Main thread, after InitWindow. Takes the image and unloads it
+    void upload(Image image) {
+        unload();
+        m_texture = LoadTextureFromImage(image);
+        UnloadImage(image);
+    }
+
+    // Decodes and uploads right here if nothing's been uploaded yet
+    const Texture2D& getTexture() {
+        if (m_texture.id == 0) {
+            upload(decode());
+        }
+        return m_texture;
+    }
+
+    void unload() {
+        if (m_texture.id != 0) {
+            UnloadTexture(m_texture);
+            m_texture = Texture2D{};
+        }
+    }
+};
+
+// Collects a frame's sprites into per layer lists and sends them all out in one textured quad batch, so
+// a scene is one texture bind and a handful of draw calls however many things are in it. Positions are
+// world pixels, so flush goes inside BeginMode2D.
+class SpriteBatch {
+    struct Sprite {
+        Pixels lower;
+        Pixels upper;
+        Color tint;
+        uint8_t region;
+        bool flipped; // Mirrored sideways, the art faces right
+        float cellWidth; // How much of the cell to use, 0 to 1. Tiles cut short at a platform's edge use less
+    };
+
+    SpriteAtlas m_atlas{};
+    std::vector<Sprite> m_layers[LAYER_COUNT]{};
+public:
+    void add(const SpriteLayer layer, const SpriteRegion region, const Pixels lower, const Pixels upper,
+             const Color tint, const bool flipped = false) {
+        m_layers[layer].push_back({lower, upper, tint, region, flipped, 1.0f});
+    }
+
+    // Repeats region across the box instead of stretching it, tiles are square at the box's height
+    void addTiled(const SpriteLayer layer, const SpriteRegion region, const Pixels lower, const Pixels upper,
+                  const Color tint) {
+        const float tileSize = upper.y - lower.y;
+        if (tileSize <= 0.0f) return;
+
+        for (float x = lower.x; x < upper.x; x += tileSize) {
+            const float right = std::min(x + tileSize, upper.x);
+            m_layers[layer].push_back({{x, lower.y}, {right, upper.y}, tint, region, false, (right - x) / tileSize});
+        }
+    }
+
+    std::size_t size() const {
+        std::size_t count = 0;
+        for (const auto& layer : m_layers) {
+            count += layer.size();
+        }
+        return count;
+    }
+
+    // Draws everything added since the last flush and clears it. rlgl splits the batch by itself if it
+    // runs past its buffer. Returns how many batches went out, for the profiler
+    int flush() {
+        if (size() == 0) return 0;
+
+        const Texture2D& texture = m_atlas.getTexture();
+        const float cellU = static_cast<float>(SPRITE_CELL_SIZE) / static_cast<float>(texture.width);
+        const float cellV = static_cast<float>(SPRITE_CELL_SIZE) / static_cast<float>(texture.height);
+
+        rlSetTexture(texture.id);
+        rlBegin(RL_QUADS);
+        for (auto& layer : m_layers) {
+            for (const Sprite& sprite : layer) {
+                float u0 = sprite.region * cellU;
+                float u1 = u0 + cellU * sprite.cellWidth;
+                if (sprite.flipped) {
+                    std::swap(u0, u1);
+                }
+
+                rlColor4ub(sprite.tint.r, sprite.tint.g, sprite.tint.b, sprite.tint.a);
+                rlTexCoord2f(u0, 0.0f);
+                rlVertex2f(sprite.lower.x, sprite.lower.y);
+                rlTexCoord2f(u0, cellV);
+                rlVertex2f(sprite.lower.x, sprite.upper.y);
+                rlTexCoord2f(u1, cellV);
+                rlVertex2f(sprite.upper.x, sprite.upper.y);
+                rlTexCoord2f(u1, 0.0f);
+                rlVertex2f(sprite.upper.x, sprite.lower.y);
+            }
+            layer.clear();
+        }
+        rlEnd();
+        rlSetTexture(0);
+
+        return 1;
+    }
+
+    // For an atlas decoded ahead of time, see SpriteAtlas::decode. Otherwise the first flush loads it
+    void uploadAtlas(const Image image) {
+        m_atlas.upload(image);
+    }
+
+    void unload() {
+        m_atlas.unload();
+    }
+};
+
+// Base object class. Only keeps what's needed after creation, the Box2D defs are temporaries. Owns
+// its body, so it can be moved but not copied.
 class BoxBody {
 protected:
     b2Vec2 m_size{};
     b2Vec2 m_centerPostion{};
-    b2BodyDef m_bodyDef{};
-    b2BodyId m_body{};
-    b2Polygon m_boundingBox{};
-    b2ShapeDef m_shapeDef{};
+    b2Vec2 m_previousPosition{};
+    BodyHandle m_body{};
 public:
     BoxBody() = default;
     virtual ~BoxBody() = default;
 
-    BoxBody(
-        const float centerX,
-        const float centerY,
-        const float fullWidth,
-        const float fullHeight,
-        const b2WorldId world) :
-        m_size{px2M(fullWidth), px2M(fullHeight)},
-        m_centerPostion{px2M(centerX), px2M(centerY)},
-        m_bodyDef(b2DefaultBodyDef())
-    {
-        m_bodyDef.position = m_centerPostion;
-        m_bodyDef.type = b2_staticBody;
-        m_body = b2CreateBody(world, &m_bodyDef);
-
-        m_boundingBox = b2MakeBox(m_size.x / 2.0f, m_size.y / 2.0f);
-        m_shapeDef = b2DefaultShapeDef();
-        m_shapeDef.material.friction = 0.50f;
-        m_shapeDef.enableSensorEvents = true;
-        b2CreatePolygonShape(m_body, &m_shapeDef, &m_boundingBox);
-    };
+    BoxBody(BoxBody&&) = default;
+    BoxBody& operator=(BoxBody&&) = default;
+protected:
+    void drawSprite(SpriteBatch& sprites, const float alpha, const SpriteLayer layer, const SpriteRegion region,
+                    const Color tint, const bool flipped) const {
+        const Meters position = getInterpolatedPosition(alpha);
+        const Meters halfSize = asMeters(m_size) / 2.0f;
 
-    virtual void unload() const {
-        b2DestroyBody(m_body);
-    };
+        sprites.add(layer, region, toPixels(position - halfSize), toPixels(position + halfSize), tint, flipped);
+    }
+public:
+    // Destroys the body now instead of whenever this goes away
+    virtual void unload() {
+        m_body.reset();
+    }
 
-    virtual void draw() const {
-        DrawRectangle(
-            static_cast<int>(m2Px(m_centerPostion.x)) - static_cast<int>(m2Px(m_size.x)) / 2,
-            static_cast<int>(m2Px(m_centerPostion.y)) - static_cast<int>(m2Px(m_size.y)) / 2,
-            static_cast<int>(m2Px(m_size.x)),
-            static_cast<int>(m2Px(m_size.y)),
-            WHITE
-        );
+    Meters getInterpolatedPosition(const float alpha) const {
+        return interpolate(asMeters(m_previousPosition), asMeters(m_centerPostion), alpha);
     }
 
     b2Vec2 getSize() const {
@@ -102,286 +617,5755 @@ public:
     }
 
     b2BodyId getBodyID() const {
-        return m_body;
+        return m_body.get();
     }
 };
 
-// Platform/floor class/invisible wall class
-class Platform final : public BoxBody { using BoxBody::BoxBody; };
-
-// Player class
-class Player final : public BoxBody {
-protected:
-    b2Polygon m_footSensorBox{};
-    b2ShapeDef m_footSensorShape{};
-    b2ShapeId m_footID{};
-    bool m_feetOnGround{};
+// Platform/floor/invisible wall storage. Static bodies are kept as a structure of arrays so draw
+// and update loops just stream through whichever arrays they actually need.
+class PlatformStore {
+    std::vector<BodyHandle> m_bodies{};
+    std::vector<b2Vec2> m_positions{}; // Meters
+    std::vector<b2Vec2> m_halfExtents{}; // Meters
+    std::vector<Color> m_colors{};
 public:
-    Player() = default;
+    // Takes pixels like everything else that builds the level, returns the new index
+    std::size_t add(
+        const float centerX,
+        const float centerY,
+        const float fullWidth,
+        const float fullHeight,
+        const Color color,
+        const b2WorldId world)
+    {
+        return add(
+            {px2M(centerX), px2M(centerY)},
+            {px2M(fullWidth) / 2.0f, px2M(fullHeight) / 2.0f},
+            DEFAULT_PLATFORM_FRICTION,
+            color,
+            world);
+    }
 
-    Player(const float centerX, const float centerY, const b2WorldId world) :
-    m_footSensorShape(b2DefaultShapeDef())
+    // Same thing, but already in meters
+    std::size_t add(
+        const b2Vec2 position,
+        const b2Vec2 halfExtents,
+        const float friction,
+        const Color color,
+        const b2WorldId world)
     {
-        // Body def and basic params
-        m_size = {px2M(60.0f), px2M(60.0f)};
-        m_centerPostion = {px2M(centerX), px2M(centerY)};
-        m_bodyDef = b2DefaultBodyDef();
-        m_bodyDef.position = m_centerPostion;
-        m_bodyDef.type = b2_dynamicBody;
-        m_bodyDef.fixedRotation = true;
-        m_bodyDef.linearDamping = 8.0f;
-        m_body = b2CreateBody(world, &m_bodyDef);
+        b2BodyDef bodyDef = b2DefaultBodyDef();
+        bodyDef.position = position;
+        bodyDef.type = b2_staticBody;
+        const b2BodyId body = b2CreateBody(world, &bodyDef);
 
-        // Shape def
-        m_boundingBox = b2MakeBox(m_size.x / 2.0f, m_size.y / 2.0f);
-        m_shapeDef = b2DefaultShapeDef();
-        m_shapeDef.material.friction = 0.40f;
-        m_shapeDef.material.restitution = 0.0f;
-        b2CreatePolygonShape(m_body, &m_shapeDef, &m_boundingBox);
-
-        // Foot sensor stuff
-        m_footSensorBox = b2MakeOffsetBox(
-            px2M(10.0f),
-            px2M(10.0f),
-            {0.0f, m_size.y / 2.0f},
-            b2MakeRot(0.0f));
-        m_footSensorShape = b2DefaultShapeDef();
-        m_footSensorShape.isSensor = true;
-        m_footSensorShape.enableSensorEvents = true;
-        m_footID = b2CreatePolygonShape(m_body, &m_footSensorShape, &m_footSensorBox);
-        m_feetOnGround = false;
+        const b2Polygon boundingBox = b2MakeBox(halfExtents.x, halfExtents.y);
+        b2ShapeDef shapeDef = b2DefaultShapeDef();
+        shapeDef.material.friction = friction;
+        shapeDef.enableSensorEvents = true;
+        shapeDef.userData = packColor(color); // So a world query can draw it without finding it in here
+        b2CreatePolygonShape(body, &shapeDef, &boundingBox);
+
+        m_bodies.emplace_back(body);
+        m_positions.push_back(position);
+        m_halfExtents.push_back(halfExtents);
+        m_colors.push_back(color);
+
+        return m_bodies.size() - 1;
     }
 
-    void update() {
-        m_centerPostion = b2Body_GetPosition(m_body);
+    // Swap and pop, so the last platform takes over the removed index
+    void remove(const std::size_t index) {
+        assert(index < size() && "Assertion failed. Platform index out of range.");
+
+        m_bodies[index] = std::move(m_bodies.back()); // Destroys the old body
+        m_positions[index] = m_positions.back();
+        m_halfExtents[index] = m_halfExtents.back();
+        m_colors[index] = m_colors.back();
+
+        m_bodies.pop_back();
+        m_positions.pop_back();
+        m_halfExtents.pop_back();
+        m_colors.pop_back();
     }
 
-    void draw() const override {
-        DrawRectangle(
-            static_cast<int>(m2Px(m_centerPostion.x)) - static_cast<int>(m2Px(m_size.x)) / 2,
-            static_cast<int>(m2Px(m_centerPostion.y)) - static_cast<int>(m2Px(m_size.y)) / 2,
-            static_cast<int>(m2Px(m_size.x)),
-            static_cast<int>(m2Px(m_size.y)),
-            RED);
+    void unload() {
+        m_bodies.clear();
+        m_positions.clear();
+        m_halfExtents.clear();
+        m_colors.clear();
+    }
 
-        #ifdef ENABLE_DEBUG
-            DrawText(TextFormat("m_position.x: %f", m_centerPostion.x), 10, 10, 15, RED);
-            DrawText(TextFormat("m_position.y: %f", m_centerPostion.y), 10, 30, 15, RED);
-            if (m_feetOnGround) {
-                DrawText("Foot sensor in contact with object", 10, 50, 15, RED);
+    void setEnabled(const bool enabled) {
+        for (const auto& body : m_bodies) {
+            if (enabled) {
+                b2Body_Enable(body.get());
             }
             else {
-                DrawText("Foot sensor not in contact with object", 10, 50, 15, RED);
+                b2Body_Disable(body.get());
             }
-        #endif
+        }
     }
 
-    void moveRight() const {
-        const float mass = b2Body_GetMass(m_body);
-
-        b2Body_ApplyLinearImpulse(
-            m_body,
-            {mass * .50f, 0.0f},
-            b2Body_GetWorldCenterOfMass(m_body),
-            true);
+    std::size_t size() const {
+        return m_bodies.size();
     }
 
-    void moveLeft() const {
-        const float mass = b2Body_GetMass(m_body);
-
-        b2Body_ApplyLinearImpulse(
-            m_body,
-            {-(mass * .50f), 0.0f},
-            b2Body_GetWorldCenterOfMass(m_body),
-            true);
+    bool empty() const {
+        return m_bodies.empty();
     }
 
-    void jump() const {
-        const float mass = b2Body_GetMass(m_body);
-        if (m_feetOnGround) {
-            b2Body_ApplyLinearImpulse(
-            m_body,
-            {0.0f, -(mass * 10.0f)},
-            b2Body_GetWorldCenterOfMass(m_body),
-            true);
-        }
+    const std::vector<b2Vec2>& getPositions() const {
+        return m_positions;
     }
 
-    void setFootStatus(const bool status) {
-        if (status != m_feetOnGround) {
-            m_feetOnGround = status;
-        }
+    const std::vector<b2Vec2>& getHalfExtents() const {
+        return m_halfExtents;
     }
 
-    b2ShapeId getFootSensorId() const {
-        return m_footID;
+    const std::vector<Color>& getColors() const {
+        return m_colors;
     }
 };
 
-// World class.
-class World {
+// Static geometry batch. Every frame the platforms in view get pulled out of Box2D with an AABB query
+// against the camera and sent as a single batch, so the cost follows what's on screen instead of how
+// big the level is. The buffers get reused, nothing is allocated once they've grown to fit a screen.
+class StaticGeometryBatch {
+    std::vector<Pixels> m_lowers{};
+    std::vector<Pixels> m_uppers{};
+    std::vector<Color> m_colors{};
+    b2AABB m_view{};
+    uint32_t m_revision{};
+    bool m_gathered{};
+
+    static bool gatherShape(const b2ShapeId shape, void* context) {
+        auto& batch = *static_cast<StaticGeometryBatch*>(context);
+
+        if (b2Body_GetType(b2Shape_GetBody(shape)) != b2_staticBody || b2Shape_IsSensor(shape)) return true;
+
+        const Color color = unpackColor(b2Shape_GetUserData(shape));
+        if (color.a == 0) return true; // Invisible, collision only
+
+        // Platforms are axis aligned boxes, so the shape's AABB is the box itself
+        const b2AABB bounds = b2Shape_GetAABB(shape);
+        batch.m_lowers.push_back(toPixels(asMeters(bounds.lowerBound)));
+        batch.m_uppers.push_back(toPixels(asMeters(bounds.upperBound)));
+        batch.m_colors.push_back(color);
+
+        return true;
+    }
 public:
-    b2WorldDef m_worldDef{};
-    b2WorldId m_worldID{};
-    Player m_player{};
-    std::vector<Platform> m_platforms{};
-    std::vector<Platform> m_invisibleWalls{};
+    // view is in meters. Disabled chunks aren't in the broadphase, so they never show up here. Static
+    // bodies don't move, so while the view and revision (World::getStaticRevision) stay put last frame's
+    // rects still hold and the query gets skipped
+    void gather(const b2WorldId world, const b2AABB view, const uint32_t revision) {
+        if (m_gathered && revision == m_revision &&
+            view.lowerBound.x == m_view.lowerBound.x && view.lowerBound.y == m_view.lowerBound.y &&
+            view.upperBound.x == m_view.upperBound.x && view.upperBound.y == m_view.upperBound.y) return;
 
-    World() :
-        m_worldDef(b2DefaultWorldDef())
-    {
-        m_worldDef.gravity = {0.0f, 20.0f};
-        m_worldID = b2CreateWorld(&m_worldDef);
-        m_player = Player(
-            30.0f,
-            300.0f,
-            m_worldID);
-
-        m_platforms.emplace_back(WINDOW_WIDTH / 2.0f, WINDOW_HEIGHT - 20.0f, WINDOW_WIDTH, 50.0f, m_worldID);
-        m_platforms.emplace_back(WINDOW_WIDTH / 4.0f, 400.0f, 130.0f, 30.0f, m_worldID);
-        m_platforms.emplace_back(WINDOW_WIDTH / 2.0f, 360.0f, 130.0f, 30.0f, m_worldID);
-        m_platforms.emplace_back(WINDOW_WIDTH * 0.75f, 400.0f, 130.0f, 30, m_worldID);
-
-        m_invisibleWalls.emplace_back(0.0f, WINDOW_HEIGHT / 2.0f, 1.0f, WINDOW_HEIGHT, m_worldID);
-        m_invisibleWalls.emplace_back(WINDOW_WIDTH, WINDOW_HEIGHT / 2.0f, 1.0f, WINDOW_HEIGHT, m_worldID);
-        TraceLog(LOG_INFO, "World created.");
+        m_view = view;
+        m_revision = revision;
+        m_gathered = true;
+        m_lowers.clear();
+        m_uppers.clear();
+        m_colors.clear();
+        b2World_OverlapAABB(world, view, b2DefaultQueryFilter(), &StaticGeometryBatch::gatherShape, this);
     }
 
-    void update() {
-        if (IsKeyDown(KEY_D)) {
-            m_player.moveRight();
-        }
-        else if (IsKeyDown(KEY_A)) {
-            m_player.moveLeft();
+    std::size_t size() const {
+        return m_colors.size();
+    }
+
+    // Platforms get tiled with the platform sprite, tinted their own color
+    void draw(SpriteBatch& sprites) const {
+        for (std::size_t i = 0; i < m_colors.size(); i++) {
+            sprites.addTiled(LAYER_PLATFORMS, SPRITE_PLATFORM, m_lowers[i], m_uppers[i], m_colors[i]);
         }
+    }
+};
 
-        if (IsKeyPressed(KEY_SPACE)) {
-            m_player.jump();
+// Uniform grid over every static shape's bounds, for answering lots of small gameplay queries at once
+// (is there ground under each of these characters, is anything in this trigger box) without a sensor
+// shape each or a trip into Box2D per query. Static bodies only change as chunks stream, so it gets
+// rebuilt from the broadphase when they do and is read only in between. Cells are flat runs of box
+// indices, one allocation for the lot.
+class PlatformGrid {
+    std::vector<b2AABB> m_boxes{}; // Meters
+    std::vector<uint32_t> m_cellStarts{}; // Cell i's boxes are m_cellBoxes[m_cellStarts[i]] to m_cellStarts[i + 1]
+    std::vector<uint32_t> m_cellBoxes{};
+    std::vector<uint32_t> m_cellNext{}; // Fill cursor per cell while building, kept so rebuilds don't allocate
+    b2Vec2 m_origin{};
+    int m_columns{};
+    int m_rows{};
+    uint32_t m_revision{};
+    bool m_built{};
+
+    static bool gatherShape(const b2ShapeId shape, void* context) {
+        if (b2Body_GetType(b2Shape_GetBody(shape)) == b2_staticBody && !b2Shape_IsSensor(shape)) {
+            static_cast<PlatformGrid*>(context)->m_boxes.push_back(b2Shape_GetAABB(shape));
         }
+        return true;
+    }
 
-        m_player.update();
-        b2World_Step(m_worldID, TIME_STEP, SUB_STEP);
-        handleSensorEvents();
+    // Clamped, anything off the grid lands in the edge cells and gets tested exactly there
+    int columnAt(const float x) const {
+        return std::clamp(static_cast<int>((x - m_origin.x) / px2M(PLATFORM_GRID_CELL_SIZE)), 0, m_columns - 1);
+    }
+
+    int rowAt(const float y) const {
+        return std::clamp(static_cast<int>((y - m_origin.y) / px2M(PLATFORM_GRID_CELL_SIZE)), 0, m_rows - 1);
     }
 
-    void draw() const {
-        for (const auto& platform : m_platforms) {
-            platform.draw();
+    void build() {
+        m_cellStarts.clear();
+        m_cellBoxes.clear();
+        if (m_boxes.empty()) return;
 
-            #ifdef ENABLE_DEBUG
-                drawDebugBodyPolygons(platform);
-                drawDebugBodyCenter(platform);
-            #endif
+        b2AABB bounds = m_boxes.front();
+        for (const b2AABB& box : m_boxes) {
+            bounds.lowerBound = b2Min(bounds.lowerBound, box.lowerBound);
+            bounds.upperBound = b2Max(bounds.upperBound, box.upperBound);
         }
 
-        m_player.draw();
-        #ifdef ENABLE_DEBUG
-            drawDebugBodyPolygons(m_player);
-            drawDebugBodyCenter(m_player);
-        #endif
-    }
+        const float cellSize = px2M(PLATFORM_GRID_CELL_SIZE);
+        m_origin = bounds.lowerBound;
+        m_columns = std::max(1, static_cast<int>(std::ceil((bounds.upperBound.x - bounds.lowerBound.x) / cellSize)));
+        m_rows = std::max(1, static_cast<int>(std::ceil((bounds.upperBound.y - bounds.lowerBound.y) / cellSize)));
 
-    void unload() const {
-        for (const auto& platform : m_platforms) {
-            platform.unload();
+        // Count per cell, then turn the counts into starts and fill
+        m_cellStarts.assign(static_cast<std::size_t>(m_columns) * m_rows + 1, 0);
+        for (const b2AABB& box : m_boxes) {
+            for (int row = rowAt(box.lowerBound.y); row <= rowAt(box.upperBound.y); row++) {
+                for (int column = columnAt(box.lowerBound.x); column <= columnAt(box.upperBound.x); column++) {
+                    m_cellStarts[row * m_columns + column + 1]++;
+                }
+            }
+        }
+        for (std::size_t i = 1; i < m_cellStarts.size(); i++) {
+            m_cellStarts[i] += m_cellStarts[i - 1];
         }
 
-        m_player.unload();
-        b2DestroyWorld(m_worldID);
+        m_cellBoxes.resize(m_cellStarts.back());
+        m_cellNext.assign(m_cellStarts.begin(), m_cellStarts.end() - 1);
+        for (std::size_t i = 0; i < m_boxes.size(); i++) {
+            const b2AABB& box = m_boxes[i];
+            for (int row = rowAt(box.lowerBound.y); row <= rowAt(box.upperBound.y); row++) {
+                for (int column = columnAt(box.lowerBound.x); column <= columnAt(box.upperBound.x); column++) {
+                    m_cellBoxes[m_cellNext[row * m_columns + column]++] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+    }
+public:
+    // Rebuilds from every static shape in bounds (meters, the level's, see World::getLevelBounds) if
+    // revision isn't the one it was built at. Returns whether it did
+    bool update(const b2WorldId world, const b2AABB& bounds, const uint32_t revision) {
+        if (m_built && revision == m_revision) return false;
 
-        TraceLog(LOG_INFO, "World destroyed.");
+        m_revision = revision;
+        m_built = true;
+        m_boxes.clear();
+
+        // A cell's worth of slack so shapes right on the edge still get picked up
+        const b2Vec2 margin = {px2M(PLATFORM_GRID_CELL_SIZE), px2M(PLATFORM_GRID_CELL_SIZE)};
+        const b2AABB query = {b2Sub(bounds.lowerBound, margin), b2Add(bounds.upperBound, margin)};
+        b2World_OverlapAABB(world, query, b2DefaultQueryFilter(), &PlatformGrid::gatherShape, this);
+        build();
+        return true;
     }
 
-    // Handle events generated by foot sensor contact.
-    void handleSensorEvents() {
-        const b2SensorEvents sensorContactEvents = b2World_GetSensorEvents(m_worldID);
+    // Meters. Touching counts, the same as resting on something
+    bool overlapsAny(const b2AABB& box) const {
+        if (m_boxes.empty()) return false;
 
-        for (std::size_t i = 0; i < sensorContactEvents.beginCount; i++) {
-            const b2SensorBeginTouchEvent& event = sensorContactEvents.beginEvents[i];
-            if (isShapeIdEqual(event.sensorShapeId, m_player.getFootSensorId())) {
-                m_player.setFootStatus(true);
+        for (int row = rowAt(box.lowerBound.y); row <= rowAt(box.upperBound.y); row++) {
+            for (int column = columnAt(box.lowerBound.x); column <= columnAt(box.upperBound.x); column++) {
+                const std::size_t cell = static_cast<std::size_t>(row) * m_columns + column;
+                for (uint32_t i = m_cellStarts[cell]; i < m_cellStarts[cell + 1]; i++) {
+                    if (b2AABB_Overlaps(box, m_boxes[m_cellBoxes[i]])) return true;
+                }
             }
         }
 
-        for (std::size_t i = 0; i < sensorContactEvents.endCount; i++) {
-            const b2SensorEndTouchEvent& event = sensorContactEvents.endEvents[i];
-            if (isShapeIdEqual(event.sensorShapeId, m_player.getFootSensorId())) {
-                m_player.setFootStatus(false);
-            }
-        }
+        return false;
+    }
+
+    std::size_t size() const {
+        return m_boxes.size();
     }
 };
 
-// Draw a BoxBody's shape for debugging purposes, based on the b2ShapeID.
-void drawDebugBodyPolygons(const BoxBody& targetBody) {
-    assert(b2Body_GetShapeCount(targetBody.getBodyID()) != 0 && "Assertion failed. Body contains no shapes.");
+// Platform flags
+constexpr uint32_t PLATFORM_INVISIBLE = 1u << 0; // Collides but doesn't get drawn
 
-    const int maxShapes = b2Body_GetShapeCount(targetBody.getBodyID());
+// Level description. Pixels, same as everything else that builds the level.
+// This is also the exact on disk record for the binary level format, so don't reorder it.
+struct PlatformDesc {
+    float centerX;
+    float centerY;
+    float fullWidth;
+    float fullHeight;
+    float friction;
+    uint32_t flags;
+};
 
-    b2ShapeId shapes[maxShapes];
-    b2Body_GetShapes(targetBody.getBodyID(), shapes, maxShapes);
-    b2Transform tf;
+// A level is cut into fixed width columns along x, so it can be streamed in around the player.
+// Platforms go in the chunk their left edge is in, reach is the last chunk any of them touch.
+// Also an on disk record.
+struct LevelChunk {
+    uint32_t first; // Index of the chunk's first platform
+    uint32_t count;
+    int32_t reach;
+    uint32_t reserved;
+};
 
-    tf.q = b2Body_GetRotation(targetBody.getBodyID());
-    tf.p = b2Body_GetPosition(targetBody.getBodyID());
+// Binary level file layout, little endian, everything 4 byte aligned:
+//   LevelFileHeader
+//   LevelChunk[chunkCount]
+//   PlatformDesc[platformCount], sorted by chunk
+// Means a level can be mapped straight into memory and walked in place.
+struct LevelFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t chunkCount;
+    uint32_t platformCount;
+    float chunkWidth;
+    uint32_t reserved;
+};
 
-    // Probably really slow, but fuck it, this is a debug function
-    for (const auto& shape : shapes) {
-        const b2Polygon polygon = b2Shape_GetPolygon(shape);
-        const int numVerts = polygon.count;
+constexpr char LEVEL_FILE_MAGIC[4] = {'B', '2', 'L', 'V'};
+constexpr uint32_t LEVEL_FILE_VERSION = 1;
+constexpr float PLATFORM_MERGE_EPSILON = 0.01f; // Pixels, edges this close count as touching when merging
 
-        b2Vec2 tfdVerts[numVerts];
-        for (size_t i = 0; i < numVerts; i++) {
-            tfdVerts[i] = b2TransformPoint(tf, polygon.vertices[i]);
-        }
+static_assert(sizeof(PlatformDesc) == 24, "PlatformDesc is an on disk record, size can't change");
+static_assert(sizeof(LevelChunk) == 16, "LevelChunk is an on disk record, size can't change");
+static_assert(sizeof(LevelFileHeader) == 24, "LevelFileHeader is an on disk record, size can't change");
 
-        for (size_t i = 0; i < numVerts; i++) {
-            if (i + 1 == numVerts) {
-                DrawLineEx(
-             m2PxVec(tfdVerts[i]),
-             m2PxVec(tfdVerts[0]),
-             1.0f,
-             DEBUG_COLOR);
-            }
-            else {
-                DrawLineEx(
-             m2PxVec(tfdVerts[i]),
-             m2PxVec(tfdVerts[i + 1]),
-             1.0f,
-             DEBUG_COLOR);
-            }
+// Read only view of a whole file. Gets mmapped where we can, on Windows it's just read into memory
+// since windows.h and raylib.h don't get along.
+class MappedFile {
+    const unsigned char* m_data{};
+    std::size_t m_size{};
+    #ifdef _WIN32
+        unsigned char* m_buffer{};
+    #endif
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            #ifdef _WIN32
+                std::swap(m_buffer, other.m_buffer);
+            #endif
         }
+        return *this;
     }
-}
 
-// Draw the center point of a BoxBody for debugging purposes.
-void drawDebugBodyCenter(const BoxBody& targetBody) {
-    const b2Vec2 origin = b2Body_GetPosition(targetBody.getBodyID());
+    ~MappedFile() {
+        close();
+    }
 
-    DrawCircleLines(
-        static_cast<int>(m2Px(origin.x)),
-        static_cast<int>(m2Px(origin.y)),
-        5.0f,
-        DEBUG_COLOR
-    );
-}
+    bool open(const char* path) {
+        close();
 
-int main() {
-    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Box2D player movement demo");
-    SetTargetFPS(60);
+        #ifdef _WIN32
+            int size = 0;
+            m_buffer = LoadFileData(path, &size);
+            if (m_buffer == nullptr) return false;
 
-    auto world = World();
+            m_data = m_buffer;
+            m_size = static_cast<std::size_t>(size);
+        #else
+            const int fd = ::open(path, O_RDONLY);
+            if (fd < 0) return false;
 
-    while (!WindowShouldClose()) {
-        world.update();
+            struct stat info{};
+            if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+                ::close(fd);
+                return false;
+            }
 
-        BeginDrawing();
-        ClearBackground(BLACK);
-        world.draw();
-        EndDrawing();
+            void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd); // The mapping keeps its own reference
+            if (mapping == MAP_FAILED) return false;
+
+            m_data = static_cast<const unsigned char*>(mapping);
+            m_size = static_cast<std::size_t>(info.st_size);
+        #endif
+
+        return true;
     }
 
-    world.unload();
+    void close() {
+        if (m_data == nullptr) return;
 
-    return 0;
-}
\ No newline at end of file
+        #ifdef _WIN32
+            UnloadFileData(m_buffer);
+            m_buffer = nullptr;
+        #else
+            munmap(const_cast<unsigned char*>(m_data), m_size);
+        #endif
+
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const unsigned char* data() const {
+        return m_data;
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+};
+
+int chunkIndexAt(const float x, const float chunkWidth) {
+    return static_cast<int>(std::floor(x / chunkWidth));
+}
+
+// One merge pass along x (or y with vertical set). Platforms with the same span across the other axis,
+// friction and flags that touch or overlap get folded into one box.
+bool mergePlatformRuns(std::vector<PlatformDesc>& platforms, const bool vertical) {
+    struct Box {
+        float start, end; // Along the merge axis
+        float low, high; // Across it
+        float friction;
+        uint32_t flags;
+    };
+
+    std::vector<Box> boxes;
+    boxes.reserve(platforms.size());
+    for (const auto& platform : platforms) {
+        const float halfWidth = platform.fullWidth / 2.0f;
+        const float halfHeight = platform.fullHeight / 2.0f;
+
+        if (vertical) {
+            boxes.push_back({
+                platform.centerY - halfHeight, platform.centerY + halfHeight,
+                platform.centerX - halfWidth, platform.centerX + halfWidth,
+                platform.friction, platform.flags});
+        }
+        else {
+            boxes.push_back({
+                platform.centerX - halfWidth, platform.centerX + halfWidth,
+                platform.centerY - halfHeight, platform.centerY + halfHeight,
+                platform.friction, platform.flags});
+        }
+    }
+
+    // Anything that can merge ends up next to each other, in order along the axis
+    std::sort(boxes.begin(), boxes.end(), [](const Box& a, const Box& b) {
+        if (a.low != b.low) return a.low < b.low;
+        if (a.high != b.high) return a.high < b.high;
+        if (a.friction != b.friction) return a.friction < b.friction;
+        if (a.flags != b.flags) return a.flags < b.flags;
+        return a.start < b.start;
+    });
+
+    std::vector<Box> merged;
+    merged.reserve(boxes.size());
+    for (const auto& box : boxes) {
+        if (!merged.empty()) {
+            Box& last = merged.back();
+            if (last.low == box.low && last.high == box.high && last.friction == box.friction &&
+                last.flags == box.flags && box.start <= last.end + PLATFORM_MERGE_EPSILON) {
+                last.end = std::max(last.end, box.end);
+                continue;
+            }
+        }
+        merged.push_back(box);
+    }
+
+    if (merged.size() == platforms.size()) return false;
+
+    platforms.clear();
+    for (const auto& box : merged) {
+        const float center = (box.start + box.end) / 2.0f;
+        const float across = (box.low + box.high) / 2.0f;
+
+        if (vertical) {
+            platforms.push_back({across, center, box.high - box.low, box.end - box.start, box.friction, box.flags});
+        }
+        else {
+            platforms.push_back({center, across, box.end - box.start, box.high - box.low, box.friction, box.flags});
+        }
+    }
+
+    return true;
+}
+
+// Folds runs of touching tiles into single boxes, rows first and then stacks of identical rows, until
+// nothing else merges. Fewer static bodies and broadphase proxies, fewer contacts with the player, and
+// no seams between tiles for it to snag on.
+void mergeAdjacentPlatforms(std::vector<PlatformDesc>& platforms) {
+    const std::size_t before = platforms.size();
+
+    bool merged = true;
+    while (merged) {
+        merged = mergePlatformRuns(platforms, false);
+        merged = mergePlatformRuns(platforms, true) || merged;
+    }
+
+    TraceLog(LOG_INFO, "Merged %d platforms into %d.", static_cast<int>(before), static_cast<int>(platforms.size()));
+}
+
+// Chunked level data. Either walks a mapped binary file in place, or owns its arrays when it was
+// built from a text file/code. Moving it around is fine, the pointers follow the storage.
+class Level {
+    const LevelChunk* m_chunks{};
+    std::size_t m_chunkCount{};
+    const PlatformDesc* m_platforms{};
+    std::size_t m_platformCount{};
+    float m_chunkWidth{CHUNK_WIDTH};
+
+    std::vector<LevelChunk> m_ownedChunks{};
+    std::vector<PlatformDesc> m_ownedPlatforms{};
+    MappedFile m_file{};
+
+    static bool hasExtension(const char* path, const char* extension) {
+        const std::size_t pathLength = std::strlen(path);
+        const std::size_t extensionLength = std::strlen(extension);
+
+        return pathLength >= extensionLength && std::strcmp(path + pathLength - extensionLength, extension) == 0;
+    }
+
+    bool loadBinary(const char* path) {
+        MappedFile file;
+        if (!file.open(path)) {
+            TraceLog(LOG_WARNING, "Couldn't open level file %s.", path);
+            return false;
+        }
+
+        LevelFileHeader header{};
+        if (file.size() < sizeof(header)) {
+            TraceLog(LOG_WARNING, "Level file %s is truncated.", path);
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        if (std::memcmp(header.magic, LEVEL_FILE_MAGIC, sizeof(LEVEL_FILE_MAGIC)) != 0) {
+            TraceLog(LOG_WARNING, "%s isn't a binary level file.", path);
+            return false;
+        }
+        if (header.version != LEVEL_FILE_VERSION) {
+            TraceLog(LOG_WARNING, "Level file %s is version %u, expected %u.", path, header.version, LEVEL_FILE_VERSION);
+            return false;
+        }
+
+        const std::size_t expectedSize = sizeof(LevelFileHeader) +
+            static_cast<std::size_t>(header.chunkCount) * sizeof(LevelChunk) +
+            static_cast<std::size_t>(header.platformCount) * sizeof(PlatformDesc);
+        if (file.size() < expectedSize || !std::isfinite(header.chunkWidth) || header.chunkWidth <= 0.0f) {
+            TraceLog(LOG_WARNING, "Level file %s is truncated or corrupt.", path);
+            return false;
+        }
+
+        const unsigned char* chunks = file.data() + sizeof(LevelFileHeader);
+        const unsigned char* platforms = chunks + header.chunkCount * sizeof(LevelChunk);
+
+        // Chunk table and platforms get checked once here so the streamer can trust them later. A bad
+        // platform would otherwise go straight into b2MakeBox and trip Box2D's asserts
+        for (uint32_t i = 0; i < header.chunkCount; i++) {
+            LevelChunk chunk{};
+            std::memcpy(&chunk, chunks + i * sizeof(LevelChunk), sizeof(chunk));
+            if (static_cast<uint64_t>(chunk.first) + chunk.count > header.platformCount) {
+                TraceLog(LOG_WARNING, "Level file %s has a bad chunk table.", path);
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < header.platformCount; i++) {
+            PlatformDesc platform{};
+            std::memcpy(&platform, platforms + i * sizeof(PlatformDesc), sizeof(platform));
+            if (!std::isfinite(platform.centerX) || !std::isfinite(platform.centerY) ||
+                !std::isfinite(platform.fullWidth) || !std::isfinite(platform.fullHeight) ||
+                platform.fullWidth <= 0.0f || platform.fullHeight <= 0.0f ||
+                !std::isfinite(platform.friction) || platform.friction < 0.0f) {
+                TraceLog(LOG_WARNING, "Level file %s is truncated or corrupt, platform %u is bad.", path, i);
+                return false;
+            }
+        }
+
+        *this = Level();
+        m_file = std::move(file);
+        m_chunks = reinterpret_cast<const LevelChunk*>(chunks);
+        m_chunkCount = header.chunkCount;
+        m_platforms = reinterpret_cast<const PlatformDesc*>(platforms);
+        m_platformCount = header.platformCount;
+        m_chunkWidth = header.chunkWidth;
+
+        return true;
+    }
+
+    // Text authoring format, one thing per line, # for comments. Pixels.
+    //   chunk_width <pixels>
+    //   platform <centerX> <centerY> <width> <height> [friction] [flags]
+    bool loadText(const char* path) {
+        std::FILE* file = std::fopen(path, "r");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open level file %s.", path);
+            return false;
+        }
+
+        std::vector<PlatformDesc> platforms;
+        float chunkWidth = CHUNK_WIDTH;
+        bool merge = false;
+        char line[256];
+        int lineNumber = 0;
+        bool ok = true;
+
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            lineNumber++;
+
+            char keyword[32] = {};
+            if (std::sscanf(line, " %31s", keyword) != 1 || keyword[0] == '#') continue;
+
+            if (std::strcmp(keyword, "chunk_width") == 0) {
+                if (std::sscanf(line, " %*s %f", &chunkWidth) != 1 || chunkWidth <= 0.0f) {
+                    ok = false;
+                }
+            }
+            else if (std::strcmp(keyword, "merge_platforms") == 0) {
+                merge = true;
+            }
+            else if (std::strcmp(keyword, "platform") == 0) {
+                PlatformDesc platform = {0.0f, 0.0f, 0.0f, 0.0f, DEFAULT_PLATFORM_FRICTION, 0};
+                const int read = std::sscanf(
+                    line,
+                    " %*s %f %f %f %f %f %u",
+                    &platform.centerX,
+                    &platform.centerY,
+                    &platform.fullWidth,
+                    &platform.fullHeight,
+                    &platform.friction,
+                    &platform.flags);
+
+                if (read < 4) {
+                    ok = false;
+                }
+                else {
+                    platforms.push_back(platform);
+                }
+            }
+            else {
+                ok = false;
+            }
+
+            if (!ok) {
+                TraceLog(LOG_WARNING, "Level file %s, line %d: couldn't parse \"%s\".", path, lineNumber, keyword);
+                break;
+            }
+        }
+
+        std::fclose(file);
+        if (!ok) return false;
+
+        if (merge) {
+            mergeAdjacentPlatforms(platforms);
+        }
+
+        *this = fromPlatforms(std::move(platforms), chunkWidth);
+        return true;
+    }
+
+public:
+    Level() = default;
+    Level(const Level&) = delete;
+    Level& operator=(const Level&) = delete;
+    Level(Level&&) = default;
+    Level& operator=(Level&&) = default;
+
+    // Buckets the platforms by chunk
+    static Level fromPlatforms(std::vector<PlatformDesc> platforms, const float chunkWidth) {
+        Level level;
+        level.m_chunkWidth = chunkWidth;
+
+        std::vector<int> chunkOf(platforms.size());
+        int chunkCount = 0;
+        for (std::size_t i = 0; i < platforms.size(); i++) {
+            const PlatformDesc& platform = platforms[i];
+            chunkOf[i] = std::max(0, ::chunkIndexAt(platform.centerX - platform.fullWidth / 2.0f, chunkWidth));
+            chunkCount = std::max(chunkCount, chunkOf[i] + 1);
+        }
+
+        level.m_ownedChunks.resize(chunkCount);
+        for (int i = 0; i < chunkCount; i++) {
+            level.m_ownedChunks[i] = {0, 0, i, 0};
+        }
+
+        for (std::size_t i = 0; i < platforms.size(); i++) {
+            const PlatformDesc& platform = platforms[i];
+            LevelChunk& chunk = level.m_ownedChunks[chunkOf[i]];
+            const int last = ::chunkIndexAt(platform.centerX + platform.fullWidth / 2.0f, chunkWidth);
+
+            chunk.count++;
+            chunk.reach = std::max(chunk.reach, last);
+        }
+
+        // Counting sort so each chunk's platforms end up contiguous
+        uint32_t first = 0;
+        for (auto& chunk : level.m_ownedChunks) {
+            chunk.first = first;
+            first += chunk.count;
+        }
+
+        std::vector<uint32_t> cursor(chunkCount);
+        for (int i = 0; i < chunkCount; i++) {
+            cursor[i] = level.m_ownedChunks[i].first;
+        }
+
+        level.m_ownedPlatforms.resize(platforms.size());
+        for (std::size_t i = 0; i < platforms.size(); i++) {
+            level.m_ownedPlatforms[cursor[chunkOf[i]]++] = platforms[i];
+        }
+
+        level.m_chunks = level.m_ownedChunks.data();
+        level.m_chunkCount = level.m_ownedChunks.size();
+        level.m_platforms = level.m_ownedPlatforms.data();
+        level.m_platformCount = level.m_ownedPlatforms.size();
+
+        return level;
+    }
+
+    // Binary or text, decided by the file's magic
+    bool load(const char* path) {
+        char magic[sizeof(LEVEL_FILE_MAGIC)] = {};
+
+        std::FILE* file = std::fopen(path, "rb");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open level file %s.", path);
+            return false;
+        }
+        const std::size_t read = std::fread(magic, 1, sizeof(magic), file);
+        std::fclose(file);
+
+        const bool isBinary = read == sizeof(magic) && std::memcmp(magic, LEVEL_FILE_MAGIC, sizeof(magic)) == 0;
+        const bool loaded = isBinary ? loadBinary(path) : loadText(path);
+
+        if (loaded) {
+            TraceLog(
+                LOG_INFO,
+                "Loaded level %s, %d platforms in %d chunks.",
+                path,
+                static_cast<int>(m_platformCount),
+                static_cast<int>(m_chunkCount));
+        }
+
+        return loaded;
+    }
+
+    bool saveBinary(const char* path) const {
+        std::FILE* file = std::fopen(path, "wb");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open %s for writing.", path);
+            return false;
+        }
+
+        LevelFileHeader header{};
+        std::memcpy(header.magic, LEVEL_FILE_MAGIC, sizeof(header.magic));
+        header.version = LEVEL_FILE_VERSION;
+        header.chunkCount = static_cast<uint32_t>(m_chunkCount);
+        header.platformCount = static_cast<uint32_t>(m_platformCount);
+        header.chunkWidth = m_chunkWidth;
+
+        const bool ok =
+            std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(m_chunks, sizeof(LevelChunk), m_chunkCount, file) == m_chunkCount &&
+            std::fwrite(m_platforms, sizeof(PlatformDesc), m_platformCount, file) == m_platformCount;
+
+        std::fclose(file);
+        if (!ok) TraceLog(LOG_WARNING, "Failed writing level file %s.", path);
+
+        return ok;
+    }
+
+    bool saveText(const char* path) const {
+        std::FILE* file = std::fopen(path, "w");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open %s for writing.", path);
+            return false;
+        }
+
+        std::fprintf(file, "# platform <centerX> <centerY> <width> <height> [friction] [flags], all in pixels\n");
+        std::fprintf(file, "# add merge_platforms to fold touching platforms together on load\n");
+        std::fprintf(file, "chunk_width %.9g\n", m_chunkWidth);
+        for (std::size_t i = 0; i < m_platformCount; i++) {
+            const PlatformDesc& platform = m_platforms[i];
+            std::fprintf(
+                file,
+                "platform %.9g %.9g %.9g %.9g %.9g %u\n",
+                platform.centerX,
+                platform.centerY,
+                platform.fullWidth,
+                platform.fullHeight,
+                platform.friction,
+                platform.flags);
+        }
+
+        const bool ok = std::ferror(file) == 0;
+        std::fclose(file);
+
+        return ok;
+    }
+
+    // .txt gets the authoring format, anything else gets binary
+    bool save(const char* path) const {
+        return hasExtension(path, ".txt") ? saveText(path) : saveBinary(path);
+    }
+
+    std::size_t getChunkCount() const {
+        return m_chunkCount;
+    }
+
+    const LevelChunk& getChunk(const std::size_t index) const {
+        return m_chunks[index];
+    }
+
+    const PlatformDesc* getChunkPlatforms(const std::size_t index) const {
+        return m_platforms + m_chunks[index].first;
+    }
+
+    std::size_t getPlatformCount() const {
+        return m_platformCount;
+    }
+
+    float getChunkWidth() const {
+        return m_chunkWidth;
+    }
+
+    // Pixels, from x = 0 to the end of the last chunk
+    float getWidth() const {
+        return m_chunkCount * m_chunkWidth;
+    }
+
+    // Pixels, around every platform. Zero sized at the origin if there aren't any
+    Rectangle getBounds() const {
+        if (m_platformCount == 0) return {0.0f, 0.0f, 0.0f, 0.0f};
+
+        float left = m_platforms[0].centerX;
+        float top = m_platforms[0].centerY;
+        float right = left;
+        float bottom = top;
+        for (std::size_t i = 0; i < m_platformCount; i++) {
+            const PlatformDesc& platform = m_platforms[i];
+            left = std::min(left, platform.centerX - platform.fullWidth / 2.0f);
+            top = std::min(top, platform.centerY - platform.fullHeight / 2.0f);
+            right = std::max(right, platform.centerX + platform.fullWidth / 2.0f);
+            bottom = std::max(bottom, platform.centerY + platform.fullHeight / 2.0f);
+        }
+
+        return {left, top, right - left, bottom - top};
+    }
+
+    int chunkIndexAt(const float x) const {
+        return ::chunkIndexAt(x, m_chunkWidth);
+    }
+};
+
+// Streams level chunks in and out around the player. Chunk prep happens on a worker thread,
+// only the b2CreateBody/Enable/Disable calls run on the main thread since the world isn't thread safe.
+// The worker only ever prefetches. Bodies get created on exactly the step a chunk comes in range,
+// prepping it on the spot if the worker hasn't got to it, so the simulation doesn't depend on thread
+// timing and input replays come out the same.
+class LevelStreamer {
+    enum class ChunkState { Unloaded, Queued, Ready, Active, Disabled };
+
+    // Body ready data, what the worker hands back
+    struct PreparedChunk {
+        std::vector<b2Vec2> positions;
+        std::vector<b2Vec2> halfExtents;
+        std::vector<float> frictions;
+        std::vector<Color> colors;
+    };
+
+    struct Chunk {
+        ChunkState state = ChunkState::Unloaded;
+        PreparedChunk prepared{};
+        PlatformStore bodies{};
+    };
+
+    Level m_level{}; // Read only once the worker is running
+    std::vector<Chunk> m_chunks{};
+    b2WorldId m_world{};
+    uint32_t m_revision{}; // Goes up whenever static bodies come or go, see getRevision
+    std::vector<int> m_centers{}; // Chunks update is streaming around, deduplicated
+    std::vector<int> m_pendingChunks{}; // Waiting on bodies from a time sliced load, see createPendingBodies
+    std::size_t m_pendingTotal{}; // Platforms in those chunks, and how many have bodies so far
+    std::size_t m_pendingCreated{};
+
+    std::thread m_worker{};
+    std::mutex m_mutex{};
+    std::condition_variable m_wake{};
+    std::deque<int> m_requests{};
+    std::vector<std::pair<int, PreparedChunk>> m_finished{};
+    bool m_stopping{};
+
+    // For a mapped level this is also where the file actually gets paged in
+    PreparedChunk prepareChunk(const std::size_t index) const {
+        const PlatformDesc* platforms = m_level.getChunkPlatforms(index);
+        const std::size_t count = m_level.getChunk(index).count;
+
+        PreparedChunk prepared;
+        prepared.positions.reserve(count);
+        prepared.halfExtents.reserve(count);
+        prepared.frictions.reserve(count);
+        prepared.colors.reserve(count);
+
+        for (std::size_t i = 0; i < count; i++) {
+            const PlatformDesc& platform = platforms[i];
+            prepared.positions.push_back({px2M(platform.centerX), px2M(platform.centerY)});
+            prepared.halfExtents.push_back({px2M(platform.fullWidth) / 2.0f, px2M(platform.fullHeight) / 2.0f});
+            prepared.frictions.push_back(platform.friction);
+            prepared.colors.push_back((platform.flags & PLATFORM_INVISIBLE) ? BLANK : WHITE);
+        }
+
+        return prepared;
+    }
+
+    void workerLoop() {
+        while (true) {
+            int index;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+                if (m_stopping) return;
+
+                index = m_requests.front();
+                m_requests.pop_front();
+            }
+
+            PreparedChunk prepared = prepareChunk(index);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_finished.emplace_back(index, std::move(prepared));
+        }
+    }
+
+    bool inRange(const int index, const int center, const int radius) const {
+        return index <= center + radius && m_level.getChunk(index).reach >= center - radius;
+    }
+
+    // Near any of this update's centers
+    bool inAnyRange(const int index, const int radius) const {
+        for (const int center : m_centers) {
+            if (inRange(index, center, radius)) return true;
+        }
+        return false;
+    }
+
+    // Picks up wherever it got to last time, the chunk's bodies so far are the progress. Makes at least
+    // one body a call, and false means it ran out of time before the chunk was done.
+    bool createBodies(Chunk& chunk, const std::chrono::steady_clock::time_point deadline) {
+        const PreparedChunk& prepared = chunk.prepared;
+        const std::size_t first = chunk.bodies.size();
+
+        for (std::size_t i = first; i < prepared.positions.size(); i++) {
+            // The clock's cheap, but not next to nothing
+            if (i > first && (i - first) % 16 == 0 && std::chrono::steady_clock::now() >= deadline) return false;
+            chunk.bodies.add(prepared.positions[i], prepared.halfExtents[i], prepared.frictions[i], prepared.colors[i], m_world);
+        }
+
+        chunk.state = ChunkState::Active;
+        m_revision++;
+        return true;
+    }
+
+    void createBodies(Chunk& chunk) {
+        createBodies(chunk, std::chrono::steady_clock::time_point::max());
+    }
+
+    // Whatever the worker's finished goes in
+    void collectPrepared() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& finished : m_finished) {
+            // Might have been prepped on the main thread in the meantime
+            if (m_chunks[finished.first].state == ChunkState::Queued) {
+                m_chunks[finished.first].prepared = std::move(finished.second);
+                m_chunks[finished.first].state = ChunkState::Ready;
+            }
+        }
+        m_finished.clear();
+    }
+
+public:
+    LevelStreamer() = default;
+    LevelStreamer(const LevelStreamer&) = delete;
+    LevelStreamer& operator=(const LevelStreamer&) = delete;
+
+    ~LevelStreamer() {
+        stop();
+    }
+
+    // Chunks in range of startX get built right away so there's ground under the player on frame one.
+    // Without the prep thread, chunks coming into prefetch range get prepared inline in update instead.
+    // A time sliced load leaves those first chunks to createPendingBodies instead, prepared on the prep
+    // thread if there is one, and update can't be called until it's done.
+    void load(Level level, const b2WorldId world, const float startX, const bool prepThread = true, const bool timeSliced = false) {
+        stop();
+
+        m_level = std::move(level);
+        m_chunks = std::vector<Chunk>(m_level.getChunkCount());
+        m_world = world;
+        m_stopping = false;
+        m_pendingChunks.clear();
+        m_pendingTotal = 0;
+        m_pendingCreated = 0;
+
+        const int center = m_level.chunkIndexAt(startX);
+        for (std::size_t i = 0; i < m_chunks.size(); i++) {
+            if (!inRange(static_cast<int>(i), center, CHUNK_LOAD_RADIUS)) continue;
+
+            if (!timeSliced) {
+                m_chunks[i].prepared = prepareChunk(i);
+                createBodies(m_chunks[i]);
+                continue;
+            }
+
+            // Backwards, pending chunks get done from the back
+            m_pendingChunks.insert(m_pendingChunks.begin(), static_cast<int>(i));
+            m_pendingTotal += m_level.getChunk(i).count;
+            if (prepThread) {
+                m_requests.push_back(static_cast<int>(i));
+                m_chunks[i].state = ChunkState::Queued;
+            }
+        }
+
+        if (prepThread) {
+            m_worker = std::thread(&LevelStreamer::workerLoop, this);
+        }
+        TraceLog(LOG_INFO, "Level streaming started, %d chunks.", static_cast<int>(m_chunks.size()));
+    }
+
+    // Rest of a time sliced load, the first chunks' bodies until deadline. True once they're all made.
+    // A chunk still on the prep thread holds everything up until it's back, nothing blocks on it.
+    bool createPendingBodies(const std::chrono::steady_clock::time_point deadline) {
+        collectPrepared();
+
+        while (!m_pendingChunks.empty()) {
+            Chunk& chunk = m_chunks[m_pendingChunks.back()];
+            if (chunk.state == ChunkState::Queued) return false;
+            if (chunk.state == ChunkState::Unloaded) {
+                chunk.prepared = prepareChunk(m_pendingChunks.back());
+                chunk.state = ChunkState::Ready;
+            }
+
+            const std::size_t before = chunk.bodies.size();
+            const bool done = createBodies(chunk, deadline);
+            m_pendingCreated += chunk.bodies.size() - before;
+            if (!done) return false;
+
+            m_pendingChunks.pop_back();
+            if (std::chrono::steady_clock::now() >= deadline) break;
+        }
+
+        return m_pendingChunks.empty();
+    }
+
+    bool isLoaded() const {
+        return m_pendingChunks.empty();
+    }
+
+    std::size_t getChunkCount() const {
+        return m_chunks.size();
+    }
+
+    // 0 to 1, how much of a time sliced load's bodies exist
+    float getLoadProgress() const {
+        return m_pendingTotal > 0 ? static_cast<float>(m_pendingCreated) / m_pendingTotal : 1.0f;
+    }
+
+    // Call once per world step, x is in pixels. Chunks stay streamed in around x and around every one
+    // of others too, so characters far from the player (a server's connected players) keep their ground
+    void update(const float x, const std::vector<float>& others = {}) {
+        assert(isLoaded() && "Assertion failed. Level streamer updated before a time sliced load finished.");
+        collectPrepared();
+
+        m_centers.clear();
+        m_centers.push_back(m_level.chunkIndexAt(x));
+        for (const float other : others) {
+            m_centers.push_back(m_level.chunkIndexAt(other));
+        }
+        std::sort(m_centers.begin(), m_centers.end());
+        m_centers.erase(std::unique(m_centers.begin(), m_centers.end()), m_centers.end());
+
+        bool queued = false;
+
+        for (std::size_t i = 0; i < m_chunks.size(); i++) {
+            Chunk& chunk = m_chunks[i];
+            const int index = static_cast<int>(i);
+
+            switch (chunk.state) {
+                case ChunkState::Unloaded:
+                case ChunkState::Queued:
+                    if (inAnyRange(index, CHUNK_LOAD_RADIUS)) {
+                        // Worker didn't get there in time, do it here rather than wait on it
+                        chunk.prepared = prepareChunk(i);
+                        createBodies(chunk);
+                    }
+                    else if (chunk.state == ChunkState::Unloaded && inAnyRange(index, CHUNK_PREFETCH_RADIUS)) {
+                        // No prep thread, loaded without one
+                        if (!m_worker.joinable()) {
+                            chunk.prepared = prepareChunk(i);
+                            chunk.state = ChunkState::Ready;
+                            break;
+                        }
+
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_requests.push_back(index);
+                        chunk.state = ChunkState::Queued;
+                        queued = true;
+                    }
+                    break;
+                case ChunkState::Ready:
+                    if (inAnyRange(index, CHUNK_LOAD_RADIUS)) {
+                        createBodies(chunk);
+                    }
+                    break;
+                case ChunkState::Active:
+                    if (!inAnyRange(index, CHUNK_KEEP_RADIUS)) {
+                        chunk.bodies.setEnabled(false);
+                        chunk.state = ChunkState::Disabled;
+                        m_revision++;
+                    }
+                    break;
+                case ChunkState::Disabled:
+                    if (inAnyRange(index, CHUNK_LOAD_RADIUS)) {
+                        chunk.bodies.setEnabled(true);
+                        chunk.state = ChunkState::Active;
+                        m_revision++;
+                    }
+                    else if (!inAnyRange(index, CHUNK_DESTROY_RADIUS)) {
+                        // Keep the prepared data, rebuilding from it is cheap
+                        chunk.bodies.unload();
+                        chunk.state = ChunkState::Ready;
+                        m_revision++;
+                    }
+                    break;
+            }
+        }
+
+        if (queued) {
+            m_wake.notify_one();
+        }
+    }
+
+    void stop() {
+        if (!m_worker.joinable()) return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_requests.clear();
+        }
+        m_wake.notify_one();
+        m_worker.join();
+
+        // Anything still waiting on the worker goes back to square one
+        m_finished.clear();
+        for (auto& chunk : m_chunks) {
+            if (chunk.state == ChunkState::Queued) {
+                chunk.state = ChunkState::Unloaded;
+            }
+        }
+    }
+
+    void unload() {
+        stop();
+
+        for (auto& chunk : m_chunks) {
+            chunk.bodies.unload();
+        }
+        m_chunks.clear();
+        m_pendingChunks.clear();
+        m_level = Level();
+        m_revision++;
+    }
+
+    // Changes whenever what's in the broadphase does, so anything built from a query over the level's
+    // bodies only has to redo it when this moves
+    uint32_t getRevision() const {
+        return m_revision;
+    }
+};
+
+// The demo layout, used when there's no level file. Same thing as levels/demo.txt
+Level demoLevel() {
+    return Level::fromPlatforms({
+        {WINDOW_WIDTH / 2.0f, WINDOW_HEIGHT - 20.0f, WINDOW_WIDTH, 50.0f, DEFAULT_PLATFORM_FRICTION, 0},
+        {WINDOW_WIDTH / 4.0f, 400.0f, 130.0f, 30.0f, DEFAULT_PLATFORM_FRICTION, 0},
+        {WINDOW_WIDTH / 2.0f, 360.0f, 130.0f, 30.0f, DEFAULT_PLATFORM_FRICTION, 0},
+        {WINDOW_WIDTH * 0.75f, 400.0f, 130.0f, 30.0f, DEFAULT_PLATFORM_FRICTION, 0}
+    }, CHUNK_WIDTH);
+}
+
+// Debug overlay built on b2World_Draw. Box2D hands every shape in view to the callbacks below, they
+// get turned into line segments in one buffer that's allocated up front, and the whole thing goes out
+// as a single batch. Culling to the view is done by Box2D through drawingBounds.
+class DebugRenderer {
+    std::vector<Pixels> m_lines{}; // Pairs of endpoints
+    b2DebugDraw m_debugDraw{};
+    bool m_enabled{true};
+
+    void addLine(const b2Vec2 start, const b2Vec2 end) {
+        if (m_lines.size() + 2 > m_lines.capacity()) return; // Full, drop it rather than allocate
+
+        m_lines.push_back(toPixels(asMeters(start)));
+        m_lines.push_back(toPixels(asMeters(end)));
+    }
+
+    void addPolygon(const b2Transform transform, const b2Vec2* vertices, const int count) {
+        for (int i = 0; i < count; i++) {
+            addLine(
+                b2TransformPoint(transform, vertices[i]),
+                b2TransformPoint(transform, vertices[(i + 1) % count]));
+        }
+    }
+
+    void addCircle(const b2Vec2 center, const float radius) {
+        constexpr int segments = 12;
+        b2Vec2 previous = {center.x + radius, center.y};
+
+        for (int i = 1; i <= segments; i++) {
+            const float angle = 2.0f * PI * static_cast<float>(i) / segments;
+            const b2Vec2 next = {center.x + radius * std::cos(angle), center.y + radius * std::sin(angle)};
+            addLine(previous, next);
+            previous = next;
+        }
+    }
+
+    static DebugRenderer& self(void* context) {
+        return *static_cast<DebugRenderer*>(context);
+    }
+
+    static void drawPolygon(const b2Vec2* vertices, const int vertexCount, b2HexColor, void* context) {
+        const b2Transform identity = {{0.0f, 0.0f}, {1.0f, 0.0f}};
+        self(context).addPolygon(identity, vertices, vertexCount);
+    }
+
+    // Body center marker goes here too, it's the only callback every body with a box shape gets
+    static void drawSolidPolygon(
+        const b2Transform transform,
+        const b2Vec2* vertices,
+        const int vertexCount,
+        float,
+        b2HexColor,
+        void* context)
+    {
+        self(context).addPolygon(transform, vertices, vertexCount);
+        self(context).addCircle(transform.p, px2M(5.0f));
+    }
+
+    static void drawCircle(const b2Vec2 center, const float radius, b2HexColor, void* context) {
+        self(context).addCircle(center, radius);
+    }
+
+    static void drawSolidCircle(const b2Transform transform, const float radius, b2HexColor, void* context) {
+        self(context).addCircle(transform.p, radius);
+    }
+
+    static void drawSegment(const b2Vec2 start, const b2Vec2 end, b2HexColor, void* context) {
+        self(context).addLine(start, end);
+    }
+
+public:
+    DebugRenderer() :
+        m_debugDraw(b2DefaultDebugDraw())
+    {
+        m_lines.reserve(MAX_DEBUG_LINES * 2);
+
+        m_debugDraw.DrawPolygonFcn = &DebugRenderer::drawPolygon;
+        m_debugDraw.DrawSolidPolygonFcn = &DebugRenderer::drawSolidPolygon;
+        m_debugDraw.DrawCircleFcn = &DebugRenderer::drawCircle;
+        m_debugDraw.DrawSolidCircleFcn = &DebugRenderer::drawSolidCircle;
+        m_debugDraw.DrawSegmentFcn = &DebugRenderer::drawSegment;
+        m_debugDraw.drawShapes = true;
+        m_debugDraw.useDrawingBounds = true;
+    }
+
+    void toggle() {
+        m_enabled = !m_enabled;
+    }
+
+    bool isEnabled() const {
+        return m_enabled;
+    }
+
+    // viewBounds is in meters, nothing outside it gets gathered. Returns how many batches went out
+    int draw(const b2WorldId world, const b2AABB viewBounds) {
+        if (!m_enabled) return 0;
+
+        m_lines.clear();
+        m_debugDraw.drawingBounds = viewBounds;
+        m_debugDraw.context = this;
+        b2World_Draw(world, &m_debugDraw);
+
+        if (m_lines.empty()) return 0;
+
+        rlBegin(RL_LINES);
+        rlColor4ub(DEBUG_COLOR.r, DEBUG_COLOR.g, DEBUG_COLOR.b, DEBUG_COLOR.a);
+        for (const auto& point : m_lines) {
+            rlVertex2f(point.x, point.y);
+        }
+        rlEnd();
+
+        return 1;
+    }
+};
+
+// Debug readouts that only get formatted when the value they show changes, and only get rasterized when
+// some line's text did. The lines are drawn into a render texture, every other frame is one textured
+// quad. The texture gets created on first draw so headless runs never need a GL context.
+class DebugTextPanel {
+    struct Line {
+        char text[64];
+        const char* format; // Literal, also tells us what the value was formatted with
+        float value;
+    };
+
+    Line m_lines[MAX_DEBUG_TEXT_LINES]{};
+    int m_lineCount{};
+    RenderTexture2D m_target{};
+    bool m_dirty{true};
+
+    void setText(const int index, const char* format, const float value, const char* text) {
+        assert(index >= 0 && index < MAX_DEBUG_TEXT_LINES && "Assertion failed. Debug text line out of range.");
+
+        Line& line = m_lines[index];
+        line.format = format;
+        line.value = value;
+        if (std::strcmp(line.text, text) != 0) {
+            std::snprintf(line.text, sizeof(line.text), "%s", text);
+            m_dirty = true;
+        }
+
+        m_lineCount = std::max(m_lineCount, index + 1);
+    }
+public:
+    DebugTextPanel() = default;
+    DebugTextPanel(const DebugTextPanel&) = delete;
+    DebugTextPanel& operator=(const DebugTextPanel&) = delete;
+
+    // format takes one float, and is only run if value or format differ from last time
+    void watch(const int index, const char* format, const float value) {
+        assert(index >= 0 && index < MAX_DEBUG_TEXT_LINES && "Assertion failed. Debug text line out of range.");
+
+        const Line& line = m_lines[index];
+        if (line.format == format && line.value == value) return;
+
+        char text[sizeof(line.text)];
+        std::snprintf(text, sizeof(text), format, value);
+        setText(index, format, value, text);
+    }
+
+    void watch(const int index, const char* text) {
+        assert(index >= 0 && index < MAX_DEBUG_TEXT_LINES && "Assertion failed. Debug text line out of range.");
+
+        if (m_lines[index].format == text) return;
+        setText(index, text, 0.0f, text);
+    }
+
+    // Screen space. The color gets baked in along with the text
+    void draw(const int x, const int y, const Color color) {
+        const int lineHeight = DEBUG_TEXT_SIZE + 5;
+
+        if (m_target.id == 0) {
+            m_target = LoadRenderTexture(WINDOW_WIDTH / 2, lineHeight * MAX_DEBUG_TEXT_LINES);
+        }
+
+        if (m_dirty) {
+            BeginTextureMode(m_target);
+            ClearBackground(BLANK);
+            for (int i = 0; i < m_lineCount; i++) {
+                DrawText(m_lines[i].text, 0, i * lineHeight, DEBUG_TEXT_SIZE, color);
+            }
+            EndTextureMode();
+            m_dirty = false;
+        }
+
+        // Render textures come out upside down
+        const Texture2D& texture = m_target.texture;
+        DrawTextureRec(
+            texture,
+            {0.0f, 0.0f, static_cast<float>(texture.width), -static_cast<float>(texture.height)},
+            {static_cast<float>(x), static_cast<float>(y)},
+            WHITE);
+    }
+
+    void unload() {
+        if (m_target.id != 0) {
+            UnloadRenderTexture(m_target);
+            m_target = RenderTexture2D{};
+        }
+    }
+};
+
+// Movement feel that can change while the game runs, see TuningWatcher. Starts out as the ruleset's
+// and uses the same units, so a file written for one ruleset needs adjusting for another (the client
+// ruleset halves the move impulse, for one).
+struct MovementTuning {
+    float gravity = GRAVITY;
+    float playerFriction = PLAYER_FRICTION;
+    float playerLinearDamping = PLAYER_LINEAR_DAMPING;
+    float playerMoveImpulse = PLAYER_MOVE_IMPULSE;
+    float playerJumpImpulse = PLAYER_JUMP_IMPULSE;
+
+    // Same kind of text format as levels, one value per line, # for comments. Anything left out keeps
+    // the ruleset's value. Nothing changes unless the whole file parses.
+    //   gravity <meters per second squared>
+    //   player_friction <friction>
+    //   player_linear_damping <damping>
+    //   player_move_impulse <impulse per step, times mass>
+    //   player_jump_impulse <impulse, times mass>
+    bool load(const char* path) {
+        std::FILE* file = std::fopen(path, "r");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open tuning file %s.", path);
+            return false;
+        }
+
+        MovementTuning loaded;
+        char line[256];
+        int lineNumber = 0;
+        bool ok = true;
+
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            lineNumber++;
+
+            char keyword[32] = {};
+            if (std::sscanf(line, " %31s", keyword) != 1 || keyword[0] == '#') continue;
+
+            float* value = nullptr;
+            if (std::strcmp(keyword, "gravity") == 0) {
+                value = &loaded.gravity;
+            }
+            else if (std::strcmp(keyword, "player_friction") == 0) {
+                value = &loaded.playerFriction;
+            }
+            else if (std::strcmp(keyword, "player_linear_damping") == 0) {
+                value = &loaded.playerLinearDamping;
+            }
+            else if (std::strcmp(keyword, "player_move_impulse") == 0) {
+                value = &loaded.playerMoveImpulse;
+            }
+            else if (std::strcmp(keyword, "player_jump_impulse") == 0) {
+                value = &loaded.playerJumpImpulse;
+            }
+
+            if (value == nullptr || std::sscanf(line, " %*s %f", value) != 1 || !std::isfinite(*value)) {
+                TraceLog(LOG_WARNING, "Tuning file %s, line %d: couldn't parse \"%s\".", path, lineNumber, keyword);
+                ok = false;
+                break;
+            }
+        }
+
+        std::fclose(file);
+        if (!ok) return false;
+
+        *this = loaded;
+        return true;
+    }
+};
+
+// Watches a tuning file and reloads it when it changes. Only looks every TUNING_POLL_INTERVAL, and
+// then it's a modification time and a length, so it costs next to nothing while the game runs.
+// Modification times are in seconds, the length catches most saves that land in the same one.
+class TuningWatcher {
+    const char* m_path;
+    long m_modTime{-1};
+    int m_length{-1};
+    double m_nextCheck{};
+public:
+    explicit TuningWatcher(const char* path) :
+        m_path(path)
+    {}
+
+    // True with tuning replaced if the file's changed since last time and loads. A file that doesn't
+    // parse leaves tuning alone, it'll get another go on the next save.
+    bool poll(const double now, MovementTuning& tuning) {
+        if (now < m_nextCheck) return false;
+        m_nextCheck = now + TUNING_POLL_INTERVAL;
+
+        if (!FileExists(m_path)) return false;
+
+        const long modTime = GetFileModTime(m_path);
+        const int length = GetFileLength(m_path);
+        if (modTime == m_modTime && length == m_length) return false;
+
+        m_modTime = modTime;
+        m_length = length;
+        return tuning.load(m_path);
+    }
+};
+
+// Player class
+class Player final : public BoxBody {
+protected:
+    ShapeHandle m_foot{};
+    int m_footContacts{}; // A count, not a bool, so walking across two touching platforms doesn't flicker
+    float m_mass{}; // Never changes after creation, so it isn't looked up on every input
+    float m_moveImpulse{}; // Tuning's impulses times the mass, see setTuning
+    float m_jumpImpulse{};
+public:
+    Player() = default;
+
+    Player(const float centerX, const float centerY, const b2WorldId world) {
+        m_size = {px2M(PLAYER_SIZE), px2M(PLAYER_SIZE)};
+        m_centerPostion = {px2M(centerX), px2M(centerY)};
+        m_previousPosition = m_centerPostion;
+        b2ShapeId foot{};
+        m_body = BodyHandle(createBody(m_centerPostion, world, nullptr, MovementTuning{}, &foot));
+        m_foot = ShapeHandle(foot);
+        m_footContacts = 0;
+        m_mass = b2Body_GetMass(m_body.get());
+        m_moveImpulse = m_mass * PLAYER_MOVE_IMPULSE;
+        m_jumpImpulse = m_mass * PLAYER_JUMP_IMPULSE;
+    }
+
+    // Body, box and foot sensor for one player. Shared with PlayerSystem so they all handle the same
+    static b2BodyId createBody(
+        const b2Vec2 position,
+        const b2WorldId world,
+        void* userData,
+        const MovementTuning& tuning,
+        b2ShapeId* footSensor)
+    {
+        const float size = px2M(PLAYER_SIZE);
+
+        // Body def and basic params
+        b2BodyDef bodyDef = b2DefaultBodyDef();
+        bodyDef.position = position;
+        bodyDef.type = b2_dynamicBody;
+        bodyDef.fixedRotation = true;
+        bodyDef.linearDamping = tuning.playerLinearDamping;
+        bodyDef.userData = userData;
+        const b2BodyId body = b2CreateBody(world, &bodyDef);
+
+        // Shape def
+        const b2Polygon boundingBox = b2MakeBox(size / 2.0f, size / 2.0f);
+        b2ShapeDef shapeDef = b2DefaultShapeDef();
+        shapeDef.material.friction = tuning.playerFriction;
+        shapeDef.material.restitution = 0.0f;
+        shapeDef.filter.categoryBits = CHARACTER_CATEGORY;
+        shapeDef.enableSensorEvents = true; // For triggers, see World::addTrigger
+        b2CreatePolygonShape(body, &shapeDef, &boundingBox);
+
+        // Foot sensor stuff, unless ground gets checked some other way
+        if (footSensor == nullptr) return body;
+
+        const b2Polygon footSensorBox = b2MakeOffsetBox(
+            px2M(FOOT_SENSOR_HALF_SIZE),
+            px2M(FOOT_SENSOR_HALF_SIZE),
+            {0.0f, size / 2.0f},
+            b2MakeRot(0.0f));
+        b2ShapeDef footSensorShape = b2DefaultShapeDef();
+        footSensorShape.isSensor = true;
+        footSensorShape.enableSensorEvents = true;
+        footSensorShape.filter.maskBits = ~CHARACTER_CATEGORY; // Ground, not other players' heads
+        *footSensor = b2CreatePolygonShape(body, &footSensorShape, &footSensorBox);
+
+        return body;
+    }
+
+    // Where the foot sensor would be for a body at position, meters
+    static b2AABB footBounds(const b2Vec2 position) {
+        const b2Vec2 foot = {position.x, position.y + px2M(PLAYER_SIZE) / 2.0f};
+        const b2Vec2 halfSize = {px2M(FOOT_SENSOR_HALF_SIZE), px2M(FOOT_SENSOR_HALF_SIZE)};
+        return {b2Sub(foot, halfSize), b2Add(foot, halfSize)};
+    }
+
+    // What createBody took from tuning, on an existing body. Contacts pick up the new friction on
+    // their next update
+    static void applyTuning(const b2BodyId body, const MovementTuning& tuning) {
+        b2Body_SetLinearDamping(body, tuning.playerLinearDamping);
+
+        // The box and the foot sensor
+        b2ShapeId shapes[2];
+        const int count = b2Body_GetShapes(body, shapes, 2);
+        for (int i = 0; i < count; i++) {
+            if (!b2Shape_IsSensor(shapes[i])) {
+                b2Shape_SetFriction(shapes[i], tuning.playerFriction);
+            }
+        }
+    }
+
+    void setTuning(const MovementTuning& tuning) {
+        applyTuning(m_body.get(), tuning);
+        m_moveImpulse = m_mass * tuning.playerMoveImpulse;
+        m_jumpImpulse = m_mass * tuning.playerJumpImpulse;
+    }
+
+    // Call before every world step. Keeps the last two states around for interpolation, if no move
+    // event comes in the player just stays where it was
+    void beginStep() {
+        m_previousPosition = m_centerPostion;
+    }
+
+    // From the world's move events, only happens if the body actually moved
+    void onMove(const b2Vec2 position) {
+        m_centerPostion = position;
+    }
+
+    struct Snapshot {
+        BodyState body;
+        b2Vec2 position;
+        b2Vec2 previousPosition;
+        int footContacts;
+    };
+
+    Snapshot saveSnapshot() const {
+        return {saveBodyState(m_body.get()), m_centerPostion, m_previousPosition, m_footContacts};
+    }
+
+    void restoreSnapshot(const Snapshot& snapshot) {
+        restoreBodyState(m_body.get(), snapshot.body);
+        m_centerPostion = snapshot.position;
+        m_previousPosition = snapshot.previousPosition;
+        m_footContacts = snapshot.footContacts;
+    }
+
+    // Box2D's sensor events after a restore are against where the foot was before it, so the count
+    // gets taken from Box2D directly once it's stepped from the restored position
+    void syncFootContacts() {
+        m_footContacts = countSensorOverlaps(m_foot.get());
+    }
+
+    // Alpha is how far we are between the last two physics steps, 0 to 1. Facing is -1 for left
+    void draw(SpriteBatch& sprites, const float alpha, const float facing) const {
+        const float speed = std::fabs(m_centerPostion.x - m_previousPosition.x) / TIME_STEP;
+        const bool moving = speed > PLAYER_IDLE_SPEED;
+        const SpriteRegion frame = playerFrame(m2Px(getInterpolatedPosition(alpha).x), moving, isOnGround());
+
+        drawSprite(sprites, alpha, LAYER_PLAYER, frame, RED, facing < 0.0f);
+    }
+
+    void writeDebugText(DebugTextPanel& panel) const {
+        panel.watch(0, "m_position.x: %f", m_centerPostion.x);
+        panel.watch(1, "m_position.y: %f", m_centerPostion.y);
+        if (isOnGround()) {
+            panel.watch(2, "Foot sensor in contact with object");
+        }
+        else {
+            panel.watch(2, "Foot sensor not in contact with object");
+        }
+    }
+
+    // Rotation is fixed, so where the impulse lands makes no difference and the center will do
+    void moveRight() const {
+        b2Body_ApplyLinearImpulseToCenter(m_body.get(), {m_moveImpulse, 0.0f}, true);
+    }
+
+    void moveLeft() const {
+        b2Body_ApplyLinearImpulseToCenter(m_body.get(), {-m_moveImpulse, 0.0f}, true);
+    }
+
+    void jump() const {
+        if (isOnGround()) {
+            b2Body_ApplyLinearImpulseToCenter(m_body.get(), {0.0f, -m_jumpImpulse}, true);
+        }
+    }
+
+    // Foot sensor handler
+    void onFootContact(const bool began) {
+        if (began) {
+            m_footContacts++;
+        }
+        else if (m_footContacts > 0) {
+            m_footContacts--;
+        }
+    }
+
+    bool isOnGround() const {
+        return m_footContacts > 0;
+    }
+
+    b2ShapeId getFootSensorId() const {
+        return m_foot.get();
+    }
+};
+
+// Work stealing task scheduler for Box2D's enqueueTask/finishTask hooks. Each worker has its own queue
+// of ranges and steals from the others once it runs dry. Whoever calls finishTask (the thread that
+// called b2World_Step) pitches in as worker 0 instead of just blocking.
+class TaskScheduler {
+    struct Task {
+        b2TaskCallback* callback;
+        void* context;
+        std::atomic<int> remaining;
+    };
+
+    struct Range {
+        Task* task;
+        int start;
+        int end;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    int m_workerCount{1};
+    std::unique_ptr<WorkerQueue[]> m_queues{};
+    std::vector<std::thread> m_threads{};
+    Task m_tasks[MAX_SCHEDULER_TASKS];
+    int m_taskCount{};
+
+    std::atomic<int> m_pending{}; // Ranges queued but not picked up yet
+    std::atomic<bool> m_stopping{};
+    std::mutex m_sleepMutex{};
+    std::condition_variable m_wake{};
+
+    // Own queue from the back, everyone else's from the front
+    bool takeRange(const int workerIndex, Range& range) {
+        for (int i = 0; i < m_workerCount; i++) {
+            const int victim = (workerIndex + i) % m_workerCount;
+            WorkerQueue& queue = m_queues[victim];
+
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.ranges.empty()) continue;
+
+            if (victim == workerIndex) {
+                range = queue.ranges.back();
+                queue.ranges.pop_back();
+            }
+            else {
+                range = queue.ranges.front();
+                queue.ranges.pop_front();
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    bool runOne(const int workerIndex) {
+        Range range{};
+        if (!takeRange(workerIndex, range)) return false;
+
+        m_pending.fetch_sub(1, std::memory_order_relaxed);
+        range.task->callback(range.start, range.end, static_cast<uint32_t>(workerIndex), range.task->context);
+        range.task->remaining.fetch_sub(1, std::memory_order_acq_rel);
+
+        return true;
+    }
+
+    void workerLoop(const int workerIndex) {
+        while (!m_stopping.load(std::memory_order_acquire)) {
+            // Box2D hands out lots of tiny stages per step, so spin a little before going to sleep
+            bool ranSomething = false;
+            for (int spin = 0; spin < 64 && !ranSomething; spin++) {
+                ranSomething = runOne(workerIndex);
+                if (!ranSomething) std::this_thread::yield();
+            }
+            if (ranSomething) continue;
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this] {
+                return m_stopping.load(std::memory_order_acquire) || m_pending.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+    void* enqueue(b2TaskCallback* callback, const int itemCount, const int minRange, void* context) {
+        // Out of task slots or nothing worth splitting, just run it here. nullptr tells Box2D it's done.
+        if (m_taskCount == MAX_SCHEDULER_TASKS || itemCount <= minRange) {
+            callback(0, itemCount, 0, context);
+            return nullptr;
+        }
+
+        const int targetRanges = m_workerCount * 4;
+        const int rangeSize = std::max(std::max(minRange, 1), (itemCount + targetRanges - 1) / targetRanges);
+        const int rangeCount = (itemCount + rangeSize - 1) / rangeSize;
+
+        Task& task = m_tasks[m_taskCount++];
+        task.callback = callback;
+        task.context = context;
+        task.remaining.store(rangeCount, std::memory_order_relaxed);
+        m_pending.fetch_add(rangeCount, std::memory_order_release);
+
+        for (int i = 0; i < rangeCount; i++) {
+            const Range range = {&task, i * rangeSize, std::min(itemCount, (i + 1) * rangeSize)};
+            WorkerQueue& queue = m_queues[i % m_workerCount];
+
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.ranges.push_back(range);
+        }
+
+        // Taking the lock means a worker can't miss this between checking m_pending and sleeping
+        { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+        m_wake.notify_all();
+
+        return &task;
+    }
+
+    void finish(Task* task) {
+        while (task->remaining.load(std::memory_order_acquire) > 0) {
+            if (!runOne(0)) std::this_thread::yield();
+        }
+    }
+
+    static void* enqueueTask(b2TaskCallback* task, int itemCount, int minRange, void* taskContext, void* userContext) {
+        return static_cast<TaskScheduler*>(userContext)->enqueue(task, itemCount, minRange, taskContext);
+    }
+
+    static void finishTask(void* userTask, void* userContext) {
+        static_cast<TaskScheduler*>(userContext)->finish(static_cast<Task*>(userTask));
+    }
+
+public:
+    // Worker count includes the stepping thread, so 1 means no extra threads at all
+    explicit TaskScheduler(const int workerCount) :
+        m_workerCount(std::max(1, std::min(workerCount, MAX_WORKER_COUNT))),
+        m_queues(std::make_unique<WorkerQueue[]>(m_workerCount))
+    {
+        for (int i = 1; i < m_workerCount; i++) {
+            m_threads.emplace_back(&TaskScheduler::workerLoop, this, i);
+        }
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    ~TaskScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stopping.store(true, std::memory_order_release);
+        }
+        m_wake.notify_all();
+
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    // Hook into a world def before b2CreateWorld. Single worker leaves Box2D on its own serial path.
+    void configure(b2WorldDef& worldDef) {
+        if (m_workerCount == 1) return;
+
+        worldDef.workerCount = m_workerCount;
+        worldDef.enqueueTask = &TaskScheduler::enqueueTask;
+        worldDef.finishTask = &TaskScheduler::finishTask;
+        worldDef.userTaskContext = this;
+    }
+
+    // Every task Box2D enqueues is finished by the end of b2World_Step, so call this after each step
+    void reset() {
+        m_taskCount = 0;
+    }
+
+    int getWorkerCount() const {
+        return m_workerCount;
+    }
+};
+
+// One step's worth of input for a player. Keyboard, script, whatever, World doesn't care where it's from.
+struct PlayerInput {
+    bool left;
+    bool right;
+    bool jump;
+    bool fire;
+};
+
+PlayerInput pollKeyboard() {
+    return {IsKeyDown(KEY_A), IsKeyDown(KEY_D), IsKeyPressed(KEY_SPACE), IsKeyPressed(KEY_F)};
+}
+
+// Four bits per input, for input logs and the network
+enum : uint8_t { INPUT_LEFT = 1u << 0, INPUT_RIGHT = 1u << 1, INPUT_JUMP = 1u << 2, INPUT_FIRE = 1u << 3 };
+constexpr int INPUT_BITS = 4;
+
+uint8_t packInput(const PlayerInput& input) {
+    return static_cast<uint8_t>(
+        (input.left ? INPUT_LEFT : 0) |
+        (input.right ? INPUT_RIGHT : 0) |
+        (input.jump ? INPUT_JUMP : 0) |
+        (input.fire ? INPUT_FIRE : 0));
+}
+
+PlayerInput unpackInput(const uint8_t bits) {
+    return {(bits & INPUT_LEFT) != 0, (bits & INPUT_RIGHT) != 0, (bits & INPUT_JUMP) != 0, (bits & INPUT_FIRE) != 0};
+}
+
+// Binary input log layout, little endian:
+//   InputLogHeader
+//   uint8_t[stepCount], one bit packed PlayerInput per world step
+struct InputLogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t stepCount;
+    uint32_t reserved;
+};
+
+constexpr char INPUT_LOG_MAGIC[4] = {'B', '2', 'I', 'N'};
+constexpr uint32_t INPUT_LOG_VERSION = 1;
+
+// Per step player input, for recording a session and replaying it step for step. Since it's per world
+// step rather than per frame, a replay doesn't care what frame rate the recording ran at.
+class InputLog {
+    std::vector<uint8_t> m_steps{};
+public:
+    void record(const PlayerInput& input) {
+        m_steps.push_back(packInput(input));
+    }
+
+    PlayerInput get(const std::size_t step) const {
+        return unpackInput(m_steps[step]);
+    }
+
+    std::size_t size() const {
+        return m_steps.size();
+    }
+
+    bool save(const char* path) const {
+        std::FILE* file = std::fopen(path, "wb");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open %s for writing.", path);
+            return false;
+        }
+
+        InputLogHeader header{};
+        std::memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+        header.version = INPUT_LOG_VERSION;
+        header.stepCount = static_cast<uint32_t>(m_steps.size());
+
+        const bool ok =
+            std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(m_steps.data(), 1, m_steps.size(), file) == m_steps.size();
+
+        std::fclose(file);
+        if (ok) {
+            TraceLog(LOG_INFO, "Saved input log %s, %d steps.", path, static_cast<int>(m_steps.size()));
+        }
+        else {
+            TraceLog(LOG_WARNING, "Failed writing input log %s.", path);
+        }
+
+        return ok;
+    }
+
+    bool load(const char* path) {
+        std::FILE* file = std::fopen(path, "rb");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open input log %s.", path);
+            return false;
+        }
+
+        InputLogHeader header{};
+        bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+            std::memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) == 0 &&
+            header.version == INPUT_LOG_VERSION;
+
+        if (ok) {
+            m_steps.resize(header.stepCount);
+            ok = std::fread(m_steps.data(), 1, m_steps.size(), file) == m_steps.size();
+        }
+
+        std::fclose(file);
+        if (!ok) {
+            m_steps.clear();
+            TraceLog(LOG_WARNING, "%s isn't a valid input log.", path);
+        }
+
+        return ok;
+    }
+};
+
+// Worker count to use when nobody says otherwise, one per core
+int defaultWorkerCount() {
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, std::min(cores, MAX_WORKER_COUNT));
+}
+
+// Crowds of scripted characters for load tests. Same bodies as Player, but everything lives in flat
+// arrays indexed by character, with no virtual calls anywhere. Positions come from Box2D's move events
+// and characters that didn't move (or are asleep) aren't touched at all, a step stamp says whether the
+// previous position is still current. Input goes out as one impulse each with the mass cached at
+// creation, and drawing is one quad batch.
+class PlayerSystem {
+public:
+    // Sensor gives every character a foot sensor shape and counts its events. Query leaves the sensors
+    // off and asks a PlatformGrid instead, see queryGround. Only static shapes count as ground that way.
+    enum class GroundCheck { Sensor, Query };
+private:
+    std::vector<BodyHandle> m_bodies{};
+    std::vector<b2ShapeId> m_footSensors{}; // Owned by their bodies, only kept for lookups. Null with GroundCheck::Query
+    std::vector<b2Vec2> m_positions{};
+    std::vector<b2Vec2> m_previousPositions{};
+    std::vector<uint32_t> m_moveSteps{}; // Step each character last moved on
+    std::vector<float> m_masses{};
+    std::vector<int> m_footContacts{};
+    std::vector<PlayerInput> m_inputs{};
+    std::vector<uint32_t> m_active{}; // Characters holding any input, the only ones applyInputs visits
+    std::vector<uint32_t> m_activeSlots{}; // Where each character is in m_active, NOT_ACTIVE if it isn't
+    MovementTuning m_tuning{};
+    GroundCheck m_groundCheck{GroundCheck::Sensor};
+    uint32_t m_step{};
+
+    static constexpr uint32_t NOT_ACTIVE = ~0u;
+
+    static bool isIdle(const PlayerInput& input) {
+        return !input.left && !input.right && !input.jump;
+    }
+
+    void setActive(const std::size_t index, const bool active) {
+        const bool wasActive = m_activeSlots[index] != NOT_ACTIVE;
+        if (active == wasActive) return;
+
+        if (active) {
+            m_activeSlots[index] = static_cast<uint32_t>(m_active.size());
+            m_active.push_back(static_cast<uint32_t>(index));
+            return;
+        }
+
+        // Swap and pop
+        const uint32_t last = m_active.back();
+        m_active[m_activeSlots[index]] = last;
+        m_activeSlots[last] = m_activeSlots[index];
+        m_active.pop_back();
+        m_activeSlots[index] = NOT_ACTIVE;
+    }
+
+    // Where a character was at the start of the current step
+    b2Vec2 previousPosition(const std::size_t index) const {
+        return m_moveSteps[index] == m_step ? m_previousPositions[index] : m_positions[index];
+    }
+public:
+    // Body user data is index + 1, so a null from anything else never matches
+    std::size_t add(const float centerX, const float centerY, const b2WorldId world) {
+        const std::size_t index = m_bodies.size();
+        const b2Vec2 position = {px2M(centerX), px2M(centerY)};
+
+        b2ShapeId footSensor = b2_nullShapeId;
+        const b2BodyId body = Player::createBody(
+            position,
+            world,
+            reinterpret_cast<void*>(static_cast<uintptr_t>(index + 1)),
+            m_tuning,
+            m_groundCheck == GroundCheck::Sensor ? &footSensor : nullptr);
+
+        m_bodies.emplace_back(body);
+        m_footSensors.push_back(footSensor);
+        m_positions.push_back(position);
+        m_previousPositions.push_back(position);
+        m_moveSteps.push_back(m_step);
+        m_masses.push_back(b2Body_GetMass(body));
+        m_footContacts.push_back(0);
+        m_inputs.push_back({false, false, false, false});
+        m_activeSlots.push_back(NOT_ACTIVE);
+
+        return index;
+    }
+
+    // Sticks until it's changed
+    void setInput(const std::size_t index, const PlayerInput& input) {
+        m_inputs[index] = input;
+        setActive(index, !isIdle(input));
+    }
+
+    // Standing still at a new spot with no input, for handing a character over to someone new. Pixels
+    void respawn(const std::size_t index, const float centerX, const float centerY) {
+        const b2Vec2 position = {px2M(centerX), px2M(centerY)};
+        b2Body_SetTransform(m_bodies[index].get(), position, b2Rot_identity);
+        b2Body_SetLinearVelocity(m_bodies[index].get(), b2Vec2_zero);
+
+        m_positions[index] = position;
+        m_previousPositions[index] = position;
+        m_moveSteps[index] = m_step;
+        setInput(index, {false, false, false, false});
+    }
+
+    // Same rules as Player, right wins over left and jumps only count on the ground. Idle characters
+    // get skipped outright, a crowd standing around costs nothing here and Box2D lets them sleep
+    void applyInputs() const {
+        for (const uint32_t i : m_active) {
+            const PlayerInput& input = m_inputs[i];
+            b2Vec2 impulse = {0.0f, 0.0f};
+
+            if (input.right) {
+                impulse.x = m_masses[i] * m_tuning.playerMoveImpulse;
+            }
+            else if (input.left) {
+                impulse.x = -(m_masses[i] * m_tuning.playerMoveImpulse);
+            }
+
+            if (input.jump && m_footContacts[i] > 0) {
+                impulse.y = -(m_masses[i] * m_tuning.playerJumpImpulse);
+            }
+
+            if (impulse.x != 0.0f || impulse.y != 0.0f) {
+                b2Body_ApplyLinearImpulseToCenter(m_bodies[i].get(), impulse, true);
+            }
+        }
+    }
+
+    // Before any characters get added
+    void setGroundCheck(const GroundCheck groundCheck) {
+        assert(m_bodies.empty() && "Assertion failed. Ground check has to be picked before adding characters.");
+        m_groundCheck = groundCheck;
+    }
+
+    GroundCheck getGroundCheck() const {
+        return m_groundCheck;
+    }
+
+    // GroundCheck::Query's stand in for sensor events, after every world step. Same footprint as the
+    // sensor. Only characters that moved this step get asked about unless everyone is, the rest are
+    // where they were and so is the ground under them (static bodies coming or going means everyone).
+    void queryGround(const PlatformGrid& grid, const bool everyone) {
+        for (std::size_t i = 0; i < m_bodies.size(); i++) {
+            if (!everyone && m_moveSteps[i] != m_step) continue;
+
+            m_footContacts[i] = grid.overlapsAny(Player::footBounds(m_positions[i])) ? 1 : 0;
+        }
+    }
+
+    // Every character there is now, and any added later
+    void setTuning(const MovementTuning& tuning) {
+        m_tuning = tuning;
+        for (const auto& body : m_bodies) {
+            Player::applyTuning(body.get(), tuning);
+        }
+    }
+
+    // Call before every world step
+    void beginStep() {
+        m_step++;
+    }
+
+    // False if the event isn't for one of ours
+    bool onMove(const b2BodyMoveEvent& event) {
+        const std::size_t index = reinterpret_cast<uintptr_t>(event.userData) - 1;
+        if (index >= m_bodies.size() || !B2_ID_EQUALS(m_bodies[index].get(), event.bodyId)) return false;
+
+        m_previousPositions[index] = m_positions[index];
+        m_positions[index] = event.transform.p;
+        m_moveSteps[index] = m_step;
+        return true;
+    }
+
+    void onFootContact(const std::size_t index, const bool began) {
+        if (began) {
+            m_footContacts[index]++;
+        }
+        else if (m_footContacts[index] > 0) {
+            m_footContacts[index]--;
+        }
+    }
+
+    // Same arrays again plus each body's state. Only restores into the system it came from, with the
+    // same characters in it. Reusing one keeps its storage, so saving doesn't allocate after the first.
+    struct Snapshot {
+        std::vector<BodyState> bodies{};
+        std::vector<b2Vec2> positions{};
+        std::vector<b2Vec2> previousPositions{};
+        std::vector<uint32_t> moveSteps{};
+        std::vector<int> footContacts{};
+        std::vector<PlayerInput> inputs{};
+        uint32_t step{};
+    };
+
+    void saveSnapshot(Snapshot& snapshot) const {
+        snapshot.bodies.resize(m_bodies.size());
+        for (std::size_t i = 0; i < m_bodies.size(); i++) {
+            snapshot.bodies[i] = saveBodyState(m_bodies[i].get());
+        }
+
+        snapshot.positions = m_positions;
+        snapshot.previousPositions = m_previousPositions;
+        snapshot.moveSteps = m_moveSteps;
+        snapshot.footContacts = m_footContacts;
+        snapshot.inputs = m_inputs;
+        snapshot.step = m_step;
+    }
+
+    void restoreSnapshot(const Snapshot& snapshot) {
+        assert(snapshot.bodies.size() == m_bodies.size());
+
+        for (std::size_t i = 0; i < m_bodies.size(); i++) {
+            restoreBodyState(m_bodies[i].get(), snapshot.bodies[i]);
+        }
+
+        m_positions = snapshot.positions;
+        m_previousPositions = snapshot.previousPositions;
+        m_moveSteps = snapshot.moveSteps;
+        m_footContacts = snapshot.footContacts;
+        m_inputs = snapshot.inputs;
+        m_step = snapshot.step;
+
+        // Impulses on different bodies don't care what order they go in, so this needn't be the old order
+        m_active.clear();
+        std::fill(m_activeSlots.begin(), m_activeSlots.end(), NOT_ACTIVE);
+        for (std::size_t i = 0; i < m_inputs.size(); i++) {
+            setActive(i, !isIdle(m_inputs[i]));
+        }
+    }
+
+    // See Player::syncFootContacts. Query results were restored with everything else and stay good
+    void syncFootContacts() {
+        if (m_groundCheck != GroundCheck::Sensor) return;
+
+        for (std::size_t i = 0; i < m_footSensors.size(); i++) {
+            m_footContacts[i] = countSensorOverlaps(m_footSensors[i]);
+        }
+    }
+
+    bool isOnGround(const std::size_t index) const {
+        return m_footContacts[index] > 0;
+    }
+
+    // Culled against view, in meters. Frames and facing come from the scripted input, no body lookups
+    void draw(SpriteBatch& sprites, const float alpha, const b2AABB view) const {
+        constexpr Meters halfSize = toMeters(Pixels{PLAYER_SIZE, PLAYER_SIZE}) / 2.0f;
+
+        for (std::size_t i = 0; i < m_bodies.size(); i++) {
+            const Meters position = interpolate(asMeters(previousPosition(i)), asMeters(m_positions[i]), alpha);
+            if (!overlaps(view, position, halfSize)) continue;
+
+            const PlayerInput& input = m_inputs[i];
+            const SpriteRegion frame = playerFrame(m2Px(position.x), input.left || input.right, m_footContacts[i] > 0);
+            const Pixels lower = toPixels(position - halfSize);
+            const Pixels upper = toPixels(position + halfSize);
+            sprites.add(LAYER_BOTS, frame, lower, upper, RED, input.left);
+        }
+    }
+
+    void unload() {
+        m_bodies.clear();
+        m_footSensors.clear();
+        m_positions.clear();
+        m_previousPositions.clear();
+        m_moveSteps.clear();
+        m_masses.clear();
+        m_footContacts.clear();
+        m_inputs.clear();
+        m_active.clear();
+        m_activeSlots.clear();
+    }
+
+    std::size_t size() const {
+        return m_bodies.size();
+    }
+
+    b2ShapeId getFootSensorId(const std::size_t index) const {
+        return m_footSensors[index];
+    }
+
+    b2Vec2 getPosition(const std::size_t index) const {
+        return m_positions[index];
+    }
+
+    b2Vec2 getVelocity(const std::size_t index) const {
+        return b2Body_GetLinearVelocity(m_bodies[index].get());
+    }
+};
+
+// Handle into a BodyPool. The slot's generation goes up every time it's recycled, so a handle to
+// something that's already been despawned just stops working instead of pointing at its replacement.
+struct PoolHandle {
+    uint32_t index;
+    uint32_t generation;
+};
+
+// Fixed size pool of identical dynamic boxes, for projectiles, pickups and the like. Slots are allocated
+// up front. A slot's body gets created the first time it's used, and from then on despawning just
+// disables it and spawning moves it into place and enables it again. Once every slot has been through
+// once nothing gets created or destroyed, and Box2D reuses its own storage for the enable/disable.
+// Bodies are released when the pool is unloaded or destroyed, whichever comes first.
+class BodyPool {
+    struct Slot {
+        BodyHandle body;
+        uint32_t generation;
+        uint32_t liveIndex; // Where it is in m_live while spawned
+        uint32_t heapIndex; // Where its expiry is in m_expiries while spawned
+        uint32_t expireStep;
+        uint32_t moveStep; // Same idea as PlayerSystem, previous is only current if this is this step
+        b2Vec2 position;
+        b2Vec2 previousPosition;
+    };
+
+    // When a spawn runs out. Every live slot has exactly one, despawning takes it out again, so the
+    // heap never holds more than capacity
+    struct Expiry {
+        uint32_t step;
+        uint32_t index;
+
+        // Min heap on step. Ties go by index, so what expires together always despawns in the same
+        // order and the free list comes out the same after a restore rebuilds this
+        bool before(const Expiry& other) const {
+            return step != other.step ? step < other.step : index < other.index;
+        }
+    };
+
+    std::vector<Slot> m_slots{};
+    std::vector<uint32_t> m_free{}; // Stack of free slot indices
+    std::vector<uint32_t> m_live{}; // Spawned slot indices, unordered
+    std::vector<Expiry> m_expiries{}; // Heap, only the front gets looked at each step. Not std::push_heap
+                                      // since despawn needs to pull entries out of the middle
+    b2Vec2 m_halfExtents{};
+    Color m_color{};
+    b2WorldId m_world{};
+    uint32_t m_step{};
+
+    void createBody(Slot& slot, const uint32_t index) {
+        b2BodyDef bodyDef = b2DefaultBodyDef();
+        bodyDef.type = b2_dynamicBody;
+        bodyDef.isEnabled = false;
+        bodyDef.userData = reinterpret_cast<void*>(static_cast<uintptr_t>(index + 1));
+        slot.body = BodyHandle(b2CreateBody(m_world, &bodyDef));
+
+        const b2Polygon box = b2MakeBox(m_halfExtents.x, m_halfExtents.y);
+        b2ShapeDef shapeDef = b2DefaultShapeDef();
+        shapeDef.enableSensorEvents = false;
+        b2CreatePolygonShape(slot.body.get(), &shapeDef, &box);
+    }
+
+    void swapExpiries(const uint32_t a, const uint32_t b) {
+        std::swap(m_expiries[a], m_expiries[b]);
+        m_slots[m_expiries[a].index].heapIndex = a;
+        m_slots[m_expiries[b].index].heapIndex = b;
+    }
+
+    void siftUp(uint32_t i) {
+        while (i > 0) {
+            const uint32_t parent = (i - 1) / 2;
+            if (!m_expiries[i].before(m_expiries[parent])) return;
+            swapExpiries(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(uint32_t i) {
+        const uint32_t count = static_cast<uint32_t>(m_expiries.size());
+        while (true) {
+            uint32_t first = i;
+            const uint32_t left = 2 * i + 1;
+            const uint32_t right = left + 1;
+            if (left < count && m_expiries[left].before(m_expiries[first])) first = left;
+            if (right < count && m_expiries[right].before(m_expiries[first])) first = right;
+            if (first == i) return;
+            swapExpiries(i, first);
+            i = first;
+        }
+    }
+
+    void pushExpiry(const uint32_t index) {
+        assert(m_expiries.size() < m_slots.size());
+        m_slots[index].heapIndex = static_cast<uint32_t>(m_expiries.size());
+        m_expiries.push_back({m_slots[index].expireStep, index});
+        siftUp(m_slots[index].heapIndex);
+    }
+
+    // Last entry fills the hole, then goes whichever way it needs to
+    void removeExpiry(const uint32_t index) {
+        const uint32_t i = m_slots[index].heapIndex;
+        const uint32_t last = static_cast<uint32_t>(m_expiries.size() - 1);
+        assert(i <= last && m_expiries[i].index == index);
+        if (i != last) swapExpiries(i, last);
+        m_expiries.pop_back();
+        if (i < last) {
+            siftDown(i);
+            siftUp(i);
+        }
+    }
+public:
+    BodyPool(const std::size_t capacity, const b2Vec2 halfExtents, const Color color) :
+        m_slots(capacity),
+        m_halfExtents(halfExtents),
+        m_color(color)
+    {
+        m_free.reserve(capacity);
+        m_live.reserve(capacity);
+        m_expiries.reserve(capacity);
+        for (std::size_t i = capacity; i > 0; i--) {
+            m_free.push_back(static_cast<uint32_t>(i - 1));
+        }
+    }
+
+    BodyPool(const BodyPool&) = delete;
+    BodyPool& operator=(const BodyPool&) = delete;
+
+    // Meters. Returns a handle with generation 0 if the pool is full, which never matches a live slot
+    PoolHandle spawn(
+        const b2WorldId world,
+        const b2Vec2 position,
+        const b2Vec2 velocity,
+        const uint32_t lifetimeSteps)
+    {
+        if (m_free.empty()) return {0, 0};
+
+        const uint32_t index = m_free.back();
+        m_free.pop_back();
+        Slot& slot = m_slots[index];
+
+        m_world = world;
+        if (B2_IS_NULL(slot.body.get())) {
+            createBody(slot, index);
+        }
+
+        // Velocity only sticks once the body is enabled
+        b2Body_SetTransform(slot.body.get(), position, b2Rot_identity);
+        b2Body_Enable(slot.body.get());
+        b2Body_SetLinearVelocity(slot.body.get(), velocity);
+        b2Body_SetAngularVelocity(slot.body.get(), 0.0f);
+
+        slot.generation++;
+        slot.liveIndex = static_cast<uint32_t>(m_live.size());
+        slot.expireStep = m_step + lifetimeSteps;
+        slot.moveStep = m_step;
+        slot.position = position;
+        slot.previousPosition = position;
+        m_live.push_back(index);
+
+        pushExpiry(index);
+
+        return {index, slot.generation};
+    }
+
+    // Stale handles are ignored
+    void despawn(const PoolHandle handle) {
+        if (!isAlive(handle)) return;
+
+        Slot& slot = m_slots[handle.index];
+        b2Body_Disable(slot.body.get());
+        slot.generation++;
+        removeExpiry(handle.index);
+
+        // Swap and pop out of the live list
+        const uint32_t last = m_live.back();
+        m_live[slot.liveIndex] = last;
+        m_slots[last].liveIndex = slot.liveIndex;
+        m_live.pop_back();
+
+        m_free.push_back(handle.index);
+    }
+
+    bool isAlive(const PoolHandle handle) const {
+        // Live slots always have an odd generation, free ones an even one
+        return handle.index < m_slots.size() &&
+               m_slots[handle.index].generation == handle.generation &&
+               (handle.generation & 1u) != 0;
+    }
+
+    // Call before every world step, despawns anything that's run out its lifetime. Only what's due
+    // gets touched, live projectiles that aren't cost nothing here
+    void beginStep() {
+        m_step++;
+
+        // Front is always live, despawn takes it off
+        while (!m_expiries.empty() && m_expiries.front().step <= m_step) {
+            const uint32_t index = m_expiries.front().index;
+            despawn({index, m_slots[index].generation});
+        }
+    }
+
+    // False if the event isn't for one of ours
+    bool onMove(const b2BodyMoveEvent& event) {
+        const std::size_t index = reinterpret_cast<uintptr_t>(event.userData) - 1;
+        if (index >= m_slots.size() || !B2_ID_EQUALS(m_slots[index].body.get(), event.bodyId)) return false;
+
+        // Already current if it was spawned this step
+        Slot& slot = m_slots[index];
+        slot.previousPosition = slot.moveStep == m_step ? slot.previousPosition : slot.position;
+        slot.position = event.transform.p;
+        slot.moveStep = m_step;
+        return true;
+    }
+
+    // Generations and the free list are kept whole so spawns after a restore pick the same slots in the
+    // same order. Everything else is only for the slots that were live, in m_live order.
+    struct Snapshot {
+        struct LiveSlot {
+            BodyState body;
+            uint32_t expireStep;
+            uint32_t moveStep;
+            b2Vec2 position;
+            b2Vec2 previousPosition;
+        };
+
+        std::vector<uint32_t> generations{};
+        std::vector<uint32_t> free{};
+        std::vector<uint32_t> live{};
+        std::vector<LiveSlot> liveSlots{};
+        uint32_t step{};
+    };
+
+    void saveSnapshot(Snapshot& snapshot) const {
+        snapshot.generations.resize(m_slots.size());
+        for (std::size_t i = 0; i < m_slots.size(); i++) {
+            snapshot.generations[i] = m_slots[i].generation;
+        }
+
+        snapshot.free = m_free;
+        snapshot.live = m_live;
+        snapshot.liveSlots.resize(m_live.size());
+        for (std::size_t i = 0; i < m_live.size(); i++) {
+            const Slot& slot = m_slots[m_live[i]];
+            snapshot.liveSlots[i] = {
+                saveBodyState(slot.body.get()),
+                slot.expireStep,
+                slot.moveStep,
+                slot.position,
+                slot.previousPosition};
+        }
+        snapshot.step = m_step;
+    }
+
+    // Anything spawned since goes back to sleep, anything despawned since comes back. Every slot that
+    // was live when the snapshot was taken already has its body, so nothing gets created here.
+    void restoreSnapshot(const Snapshot& snapshot) {
+        assert(snapshot.generations.size() == m_slots.size());
+
+        for (const uint32_t index : m_live) {
+            if ((snapshot.generations[index] & 1u) == 0) {
+                b2Body_Disable(m_slots[index].body.get());
+            }
+        }
+
+        for (std::size_t i = 0; i < snapshot.live.size(); i++) {
+            Slot& slot = m_slots[snapshot.live[i]];
+            const Snapshot::LiveSlot& state = snapshot.liveSlots[i];
+            assert(B2_IS_NON_NULL(slot.body.get()));
+
+            // Same as spawn, enabled first so the velocity sticks
+            if ((slot.generation & 1u) == 0) {
+                b2Body_Enable(slot.body.get());
+            }
+            restoreBodyState(slot.body.get(), state.body);
+
+            slot.liveIndex = static_cast<uint32_t>(i);
+            slot.expireStep = state.expireStep;
+            slot.moveStep = state.moveStep;
+            slot.position = state.position;
+            slot.previousPosition = state.previousPosition;
+        }
+
+        for (std::size_t i = 0; i < m_slots.size(); i++) {
+            m_slots[i].generation = snapshot.generations[i];
+        }
+        m_free = snapshot.free;
+        m_live = snapshot.live;
+        m_step = snapshot.step;
+
+        m_expiries.clear();
+        for (const uint32_t index : m_live) {
+            pushExpiry(index);
+        }
+    }
+
+    // Culled against view, in meters
+    void draw(SpriteBatch& sprites, const SpriteLayer layer, const SpriteRegion region, const float alpha,
+              const b2AABB view) const {
+        const Meters halfExtents = asMeters(m_halfExtents);
+        for (const uint32_t index : m_live) {
+            const Slot& slot = m_slots[index];
+            const b2Vec2 previous = slot.moveStep == m_step ? slot.previousPosition : slot.position;
+            const Meters position = interpolate(asMeters(previous), asMeters(slot.position), alpha);
+            if (!overlaps(view, position, halfExtents)) continue;
+
+            sprites.add(layer, region, toPixels(position - halfExtents), toPixels(position + halfExtents), m_color);
+        }
+    }
+
+    void unload() {
+        for (auto& slot : m_slots) {
+            slot.body.reset();
+
+            // Keep generations going so old handles stay dead
+            slot.generation += (slot.generation & 1u);
+        }
+
+        m_live.clear();
+        m_expiries.clear();
+        m_free.clear();
+        for (std::size_t i = m_slots.size(); i > 0; i--) {
+            m_free.push_back(static_cast<uint32_t>(i - 1));
+        }
+    }
+
+    std::size_t size() const {
+        return m_live.size();
+    }
+
+    std::size_t capacity() const {
+        return m_slots.size();
+    }
+};
+
+// Runtime instrumentation. Scoped zones go into a fixed ring buffer that can be written out as Chrome
+// trace JSON (chrome://tracing or ui.perfetto.dev), and once a frame the frame time, time in
+// b2World_Step, Box2D's profile and counters and our batch count get sampled for the HUD. Nothing
+// allocates after construction. Main thread only.
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Times the rest of the enclosing scope
+    class Zone {
+        Profiler& m_profiler;
+        const char* m_name;
+        Clock::time_point m_start;
+    public:
+        Zone(Profiler& profiler, const char* name) :
+            m_profiler(profiler),
+            m_name(name),
+            m_start(Clock::now())
+        {}
+
+        ~Zone() {
+            m_profiler.record(m_name, m_start, Clock::now());
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    };
+private:
+    struct TraceEvent {
+        const char* name; // Always a literal
+        int64_t start; // Microseconds since m_epoch
+        int64_t duration;
+    };
+
+    std::vector<TraceEvent> m_events{};
+    std::size_t m_nextEvent{};
+    bool m_wrapped{};
+    bool m_tracing{true};
+    Clock::time_point m_epoch{};
+
+    std::vector<float> m_frameHistory{}; // Milliseconds, rings indexed by m_nextSample
+    std::vector<float> m_stepHistory{};
+    std::size_t m_nextSample{};
+    float m_stepTime{}; // Time in b2World_Step so far this frame, could be several steps
+    int m_batches{}; // Draw batches submitted so far this frame
+    int m_lastBatches{};
+    float m_latency{}; // Milliseconds from input poll to present, last frame
+    b2Profile m_profile{};
+    b2Counters m_counters{};
+    bool m_hudVisible{};
+
+    static int64_t microseconds(const Clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
+    float latest(const std::vector<float>& history) const {
+        return history[(m_nextSample + PROFILER_HISTORY - 1) % PROFILER_HISTORY];
+    }
+
+    void drawGraph(const std::vector<float>& history, const float x, const float y, const float height, const Color color) const {
+        rlBegin(RL_LINES);
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        for (int i = 1; i < PROFILER_HISTORY; i++) {
+            const float previous = history[(m_nextSample + i - 1) % PROFILER_HISTORY];
+            const float current = history[(m_nextSample + i) % PROFILER_HISTORY];
+
+            rlVertex2f(x + i - 1, y + height - std::min(previous / PROFILER_GRAPH_MS, 1.0f) * height);
+            rlVertex2f(x + i, y + height - std::min(current / PROFILER_GRAPH_MS, 1.0f) * height);
+        }
+        rlEnd();
+    }
+public:
+    Profiler() :
+        m_events(MAX_TRACE_ZONES),
+        m_epoch(Clock::now()),
+        m_frameHistory(PROFILER_HISTORY, 0.0f),
+        m_stepHistory(PROFILER_HISTORY, 0.0f)
+    {}
+
+    void record(const char* name, const Clock::time_point start, const Clock::time_point end) {
+        if (!m_tracing) return;
+
+        m_events[m_nextEvent] = {name, microseconds(start - m_epoch), microseconds(end - start)};
+
+        m_nextEvent++;
+        if (m_nextEvent == m_events.size()) {
+            m_nextEvent = 0;
+            m_wrapped = true;
+        }
+    }
+
+    // b2World_Step gets its own zone and feeds the step time graph
+    void recordStep(const Clock::time_point start, const Clock::time_point end) {
+        record("b2World_Step", start, end);
+        m_stepTime += std::chrono::duration<float, std::milli>(end - start).count();
+    }
+
+    void countBatches(const int batches) {
+        m_batches += batches;
+    }
+
+    // From FramePacer, only windowed runs have one
+    void recordLatency(const float milliseconds) {
+        m_latency = milliseconds;
+    }
+
+    // Closes out the last frame. frameTime is how long it took, in seconds, same as GetFrameTime
+    void beginFrame(const float frameTime, const b2WorldId world) {
+        m_frameHistory[m_nextSample] = frameTime * 1000.0f;
+        m_stepHistory[m_nextSample] = m_stepTime;
+        m_nextSample = (m_nextSample + 1) % PROFILER_HISTORY;
+
+        m_lastBatches = m_batches;
+        m_batches = 0;
+        m_stepTime = 0.0f;
+
+        // Only worth the calls when someone's looking
+        if (m_hudVisible) {
+            m_profile = b2World_GetProfile(world);
+            m_counters = b2World_GetCounters(world);
+        }
+    }
+
+    void toggleHud() {
+        m_hudVisible = !m_hudVisible;
+    }
+
+    // Off drops the trace ring, for worlds nobody's ever going to look at. Step time still adds up.
+    void setTracing(const bool tracing) {
+        m_tracing = tracing;
+        m_events = tracing ? std::vector<TraceEvent>(MAX_TRACE_ZONES) : std::vector<TraceEvent>();
+        m_nextEvent = 0;
+        m_wrapped = false;
+    }
+
+    // Screen space, top right corner. The graph has frame time in green and step time in yellow
+    void drawHud() const {
+        if (!m_hudVisible) return;
+
+        const int x = WINDOW_WIDTH - PROFILER_HISTORY - 10;
+        constexpr int y = 10;
+        constexpr int lineHeight = 14;
+        constexpr int graphHeight = 60;
+
+        DrawRectangle(x - 5, y - 5, PROFILER_HISTORY + 10, lineHeight * 7 + graphHeight + 15, Fade(BLACK, 0.75f));
+
+        DrawText(TextFormat("frame %.2f ms  step %.2f ms", latest(m_frameHistory), latest(m_stepHistory)), x, y, 10, GREEN);
+        DrawText(TextFormat("box2d step %.2f  pairs %.2f  collide %.2f", m_profile.step, m_profile.pairs, m_profile.collide), x, y + lineHeight, 10, WHITE);
+        DrawText(TextFormat("solve %.2f  sensors %.2f", m_profile.solve, m_profile.sensors), x, y + lineHeight * 2, 10, WHITE);
+        DrawText(TextFormat("bodies %d  shapes %d  contacts %d", m_counters.bodyCount, m_counters.shapeCount, m_counters.contactCount), x, y + lineHeight * 3, 10, WHITE);
+        DrawText(TextFormat("islands %d  tasks %d  batches %d", m_counters.islandCount, m_counters.taskCount, m_lastBatches), x, y + lineHeight * 4, 10, WHITE);
+        DrawText(TextFormat("input to present %.2f ms", m_latency), x, y + lineHeight * 5, 10, WHITE);
+        DrawText(TextFormat("F3 saves %s", TRACE_PATH), x, y + lineHeight * 6, 10, GRAY);
+
+        const float graphY = static_cast<float>(y + lineHeight * 7 + 5);
+        drawGraph(m_frameHistory, static_cast<float>(x), graphY, graphHeight, GREEN);
+        drawGraph(m_stepHistory, static_cast<float>(x), graphY, graphHeight, YELLOW);
+    }
+
+    // Oldest zone first. Complete ("X") events, everything on one thread
+    bool saveTrace(const char* path) const {
+        std::FILE* file = std::fopen(path, "w");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open %s for writing.", path);
+            return false;
+        }
+
+        const std::size_t count = m_wrapped ? m_events.size() : m_nextEvent;
+        const std::size_t first = m_wrapped ? m_nextEvent : 0;
+
+        std::fprintf(file, "{\"traceEvents\":[\n");
+        for (std::size_t i = 0; i < count; i++) {
+            const TraceEvent& event = m_events[(first + i) % m_events.size()];
+            std::fprintf(
+                file,
+                "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":1}%s\n",
+                event.name,
+                static_cast<long long>(event.start),
+                static_cast<long long>(event.duration),
+                i + 1 < count ? "," : "");
+        }
+        std::fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+
+        const bool ok = std::ferror(file) == 0;
+        std::fclose(file);
+        if (ok) {
+            TraceLog(LOG_INFO, "Saved trace %s, %d zones.", path, static_cast<int>(count));
+        }
+
+        return ok;
+    }
+};
+
+// World class.
+// Everything in a World that changes from step to step, for rolling back and resimulating. Static
+// geometry and level streaming aren't in it, the streamer catches up from the restored player position
+// on the next step. Keep one around and save into it repeatedly, it holds onto its storage.
+struct WorldSnapshot {
+    Player::Snapshot player{};
+    PlayerSystem::Snapshot bots{};
+    BodyPool::Snapshot projectiles{};
+    float facing{};
+
+    std::size_t byteCount() const {
+        return sizeof(*this) +
+               bots.bodies.size() * sizeof(BodyState) +
+               (bots.positions.size() + bots.previousPositions.size()) * sizeof(b2Vec2) +
+               bots.moveSteps.size() * sizeof(uint32_t) +
+               bots.footContacts.size() * sizeof(int) +
+               bots.inputs.size() * sizeof(PlayerInput) +
+               (projectiles.generations.size() + projectiles.free.size() + projectiles.live.size()) * sizeof(uint32_t) +
+               projectiles.liveSlots.size() * sizeof(BodyPool::Snapshot::LiveSlot);
+    }
+};
+
+class World {
+public:
+    TaskScheduler m_scheduler; // Has to outlive the Box2D world
+    b2WorldDef m_worldDef{};
+    WorldHandle m_worldID{}; // Declared before everything that holds bodies so it's destroyed after them
+    Player m_player{};
+    PlayerSystem m_bots{}; // Scripted players, for benchmarks and headless runs
+    BodyPool m_projectiles{MAX_PROJECTILES, {px2M(PROJECTILE_SIZE) / 2.0f, px2M(PROJECTILE_SIZE) / 2.0f}, ORANGE};
+    PlatformStore m_platforms{};
+    PlatformStore m_invisibleWalls{};
+    std::vector<BodyHandle> m_triggers{}; // Static sensor boxes, see addTrigger
+    LevelStreamer m_level{};
+    SensorRegistry m_sensors{};
+    StaticGeometryBatch m_staticGeometry{};
+    PlatformGrid m_ground{}; // Only built if the bots use GroundCheck::Query
+    SpriteBatch m_sprites{};
+    DebugRenderer m_debugDraw{};
+    DebugTextPanel m_debugText{};
+    Camera2D m_camera{};
+    float m_levelWidth{};
+    b2AABB m_levelBounds{}; // Meters, around the walls and every platform, streamed in or not
+    float m_accumulator{};
+    bool m_jumpQueued{};
+    bool m_fireQueued{};
+    float m_facing{1.0f}; // Last direction the player moved in, projectiles go this way
+    bool m_footContactsStale{}; // Set by a restore, foot contact counts get resynced after the next step
+    uint32_t m_platformEdits{}; // addPlatform and removePlatform calls, part of getStaticRevision
+    std::vector<float> m_streamingFocus{}; // Pixel x positions the level streams around besides the player's
+    InputLog* m_recording{}; // Every step's player input gets appended here when set
+    Profiler m_profiler{};
+
+    // Falls back to the demo layout if there's no level file or it won't load
+    explicit World(const char* levelPath = nullptr, const int workerCount = defaultWorkerCount()) :
+        World(loadLevelOrDemo(levelPath), workerCount)
+    {}
+
+    // Without the streaming thread the level streamer preps chunks inline, for running lots of worlds.
+    // A time sliced load leaves the first chunks' bodies to finishLoading, nothing can step until it's done.
+    // Box2D only has room for so many worlds, see isValid.
+    World(Level level, const int workerCount, const bool streamingThread = true, const bool timeSlicedLoad = false) :
+        m_scheduler(workerCount),
+        m_worldDef(makeWorldDef(m_scheduler)),
+        m_worldID(b2CreateWorld(&m_worldDef)),
+        m_player(b2World_IsValid(m_worldID.get()) ? Player(30.0f, 300.0f, m_worldID.get()) : Player())
+    {
+        if (!isValid()) {
+            TraceLog(LOG_WARNING, "Box2D couldn't create another world, %d can exist at once.", MAX_BATCH_WORLDS);
+            return;
+        }
+
+        m_sensors.add(m_player.getFootSensorId(), [this](b2ShapeId, const bool began) {
+            m_player.onFootContact(began);
+        });
+
+        // Walls go at the level's edges, for the demo layout that's the edges of the window
+        m_levelWidth = std::max(static_cast<float>(WINDOW_WIDTH), level.getWidth());
+        m_invisibleWalls.add(0.0f, WINDOW_HEIGHT / 2.0f, 1.0f, WINDOW_HEIGHT, BLANK, m_worldID.get());
+        m_invisibleWalls.add(m_levelWidth, WINDOW_HEIGHT / 2.0f, 1.0f, WINDOW_HEIGHT, BLANK, m_worldID.get());
+        m_levelBounds = {{0.0f, 0.0f}, {px2M(m_levelWidth), px2M(WINDOW_HEIGHT)}};
+        if (level.getPlatformCount() > 0) {
+            const Rectangle platforms = level.getBounds();
+            growLevelBounds(platforms.x, platforms.y, platforms.x + platforms.width, platforms.y + platforms.height);
+        }
+
+        m_camera.offset = {WINDOW_WIDTH / 2.0f, WINDOW_HEIGHT / 2.0f};
+        m_camera.zoom = 1.0f;
+        updateCamera(1.0f);
+
+        m_level.load(std::move(level), m_worldID.get(), m2Px(m_player.getPosition().x), streamingThread, timeSlicedLoad);
+        TraceLog(LOG_INFO, "World created.");
+    }
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // False if Box2D had no room for another world. Then there's nothing in it and all it's good for is unload
+    bool isValid() const {
+        return b2World_IsValid(m_worldID.get());
+    }
+
+    static b2WorldDef makeWorldDef(TaskScheduler& scheduler) {
+        b2WorldDef worldDef = b2DefaultWorldDef();
+        worldDef.gravity = {0.0f, GRAVITY};
+        scheduler.configure(worldDef);
+        return worldDef;
+    }
+
+    static Level loadLevelOrDemo(const char* levelPath) {
+        Level level;
+        if (levelPath == nullptr || !level.load(levelPath)) {
+            level = demoLevel();
+        }
+        return level;
+    }
+
+    // Makes bodies for a time sliced load until deadline, true once they're all there
+    bool finishLoading(const std::chrono::steady_clock::time_point deadline) {
+        return m_level.createPendingBodies(deadline);
+    }
+
+    bool isLoaded() const {
+        return m_level.isLoaded();
+    }
+
+    float getLoadProgress() const {
+        return m_level.getLoadProgress();
+    }
+
+    // Bots are steered through setBotInput, it sticks until it's changed
+    std::size_t addBot(const float centerX, const float centerY) {
+        const std::size_t index = m_bots.add(centerX, centerY, m_worldID.get());
+
+        if (m_bots.getGroundCheck() == PlayerSystem::GroundCheck::Sensor) {
+            m_sensors.add(m_bots.getFootSensorId(index), [this, index](b2ShapeId, const bool began) {
+                m_bots.onFootContact(index, began);
+            });
+        }
+
+        return index;
+    }
+
+    void setBotInput(const std::size_t index, const PlayerInput& input) {
+        m_bots.setInput(index, input);
+    }
+
+    void addPlatform(const float centerX, const float centerY, const float fullWidth, const float fullHeight) {
+        m_platforms.add(centerX, centerY, fullWidth, fullHeight, WHITE, m_worldID.get());
+        m_platformEdits++;
+        growLevelBounds(centerX - fullWidth / 2.0f, centerY - fullHeight / 2.0f,
+                        centerX + fullWidth / 2.0f, centerY + fullHeight / 2.0f);
+    }
+
+    void removePlatform(const std::size_t index) {
+        m_platforms.remove(index);
+        m_platformEdits++;
+    }
+
+    // Invisible box that calls handler whenever a player or bot goes in or out of it. Pixels, same as
+    // addPlatform. Triggers don't stream and aren't in snapshots, they stay put until unload
+    std::size_t addTrigger(const float centerX, const float centerY, const float fullWidth, const float fullHeight,
+                           SensorRegistry::Handler handler) {
+        b2BodyDef bodyDef = b2DefaultBodyDef();
+        bodyDef.position = {px2M(centerX), px2M(centerY)};
+        bodyDef.type = b2_staticBody;
+        m_triggers.emplace_back(b2CreateBody(m_worldID.get(), &bodyDef));
+
+        const b2Polygon box = b2MakeBox(px2M(fullWidth) / 2.0f, px2M(fullHeight) / 2.0f);
+        b2ShapeDef shapeDef = b2DefaultShapeDef();
+        shapeDef.isSensor = true;
+        shapeDef.enableSensorEvents = true;
+        shapeDef.filter.maskBits = CHARACTER_CATEGORY;
+        m_sensors.add(b2CreatePolygonShape(m_triggers.back().get(), &shapeDef, &box), std::move(handler));
+
+        return m_triggers.size() - 1;
+    }
+
+    // Pixel x positions to keep the level streamed in around from the next step on, as well as the
+    // player's. Sticks until it's changed, an empty list is just the player again
+    void setStreamingFocus(const std::vector<float>& xs) {
+        m_streamingFocus.assign(xs.begin(), xs.end());
+    }
+
+    // Meters. Every static body there is or will be streamed in fits inside, it only ever grows
+    b2AABB getLevelBounds() const {
+        return m_levelBounds;
+    }
+
+    // Moves whenever static bodies come or go, streamed or added by hand. Both only ever go up, so the
+    // sum does too
+    uint32_t getStaticRevision() const {
+        return m_level.getRevision() + m_platformEdits;
+    }
+
+    // Applies to every body there is right away, impulses change from the next step. Saved snapshots
+    // don't carry tuning, a restore keeps whatever's current.
+    void setTuning(const MovementTuning& tuning) {
+        b2World_SetGravity(m_worldID.get(), {0.0f, tuning.gravity});
+        m_player.setTuning(tuning);
+        m_bots.setTuning(tuning);
+    }
+
+    // Runs however many fixed steps fit in the time since the last frame, could be none.
+    void update(const float frameTime, const PlayerInput& input) {
+        update(frameTime, input, [this](const PlayerInput& stepInput) { step(stepInput); });
+    }
+
+    // Same, but each step goes through stepFunction, which has to end up calling step. For anything that
+    // wants to do its own thing around every step, like network prediction.
+    template <typename StepFunction>
+    void update(const float frameTime, const PlayerInput& input, StepFunction&& stepFunction) {
+        m_profiler.beginFrame(frameTime, m_worldID.get());
+        Profiler::Zone zone(m_profiler, "World::update");
+
+        // Key presses only last a frame, hold onto it until a step actually happens
+        if (input.jump) {
+            m_jumpQueued = true;
+        }
+        if (input.fire) {
+            m_fireQueued = true;
+        }
+
+        m_accumulator += frameTime;
+
+        int steps = 0;
+        while (m_accumulator >= TIME_STEP && steps < MAX_STEPS_PER_FRAME) {
+            stepFunction(PlayerInput{input.left, input.right, m_jumpQueued, m_fireQueued});
+            m_jumpQueued = false;
+            m_fireQueued = false;
+            m_accumulator -= TIME_STEP;
+            steps++;
+        }
+
+        // Way behind, drop the backlog instead of trying to catch up (spiral of death)
+        if (m_accumulator >= TIME_STEP) {
+            m_accumulator = std::fmod(m_accumulator, TIME_STEP);
+        }
+    }
+
+    // One fixed step. Headless stuff can drive this directly and skip update's accumulator.
+    void step(const PlayerInput& input) {
+        Profiler::Zone zone(m_profiler, "World::step");
+
+        if (m_recording != nullptr) {
+            m_recording->record(input);
+        }
+
+        m_level.update(m2Px(m_player.getPosition().x), m_streamingFocus);
+
+        applyInput(m_player, input);
+        m_bots.applyInputs();
+
+        m_player.beginStep();
+        m_bots.beginStep();
+        m_projectiles.beginStep();
+
+        if (input.right) {
+            m_facing = 1.0f;
+        }
+        else if (input.left) {
+            m_facing = -1.0f;
+        }
+        if (input.fire) {
+            fireProjectile();
+        }
+
+        const auto stepStart = Profiler::Clock::now();
+        b2World_Step(m_worldID.get(), TIME_STEP, SUB_STEP);
+        m_profiler.recordStep(stepStart, Profiler::Clock::now());
+        m_scheduler.reset();
+        handleMoveEvents();
+        handleSensorEvents();
+
+        if (m_bots.getGroundCheck() == PlayerSystem::GroundCheck::Query) {
+            const bool rebuilt = m_ground.update(m_worldID.get(), m_levelBounds, getStaticRevision());
+            m_bots.queryGround(m_ground, rebuilt);
+        }
+
+        if (m_footContactsStale) {
+            m_player.syncFootContacts();
+            m_bots.syncFootContacts();
+            m_footContactsStale = false;
+        }
+    }
+
+    // Between steps only. Doesn't allocate once snapshot has been through a save at the same size.
+    void saveSnapshot(WorldSnapshot& snapshot) const {
+        snapshot.player = m_player.saveSnapshot();
+        m_bots.saveSnapshot(snapshot.bots);
+        m_projectiles.saveSnapshot(snapshot.projectiles);
+        snapshot.facing = m_facing;
+    }
+
+    // Puts the world back to where it was when snapshot was saved, ready to step again from there. Queued
+    // input and the frame accumulator are left alone, those belong to the frame rather than the step.
+    // Bots added since the snapshot was taken can't be restored over.
+    void restoreSnapshot(const WorldSnapshot& snapshot) {
+        Profiler::Zone zone(m_profiler, "World::restoreSnapshot");
+
+        m_player.restoreSnapshot(snapshot.player);
+        m_bots.restoreSnapshot(snapshot.bots);
+        m_projectiles.restoreSnapshot(snapshot.projectiles);
+        m_facing = snapshot.facing;
+        m_footContactsStale = true;
+    }
+
+    void draw() {
+        draw([](SpriteBatch&) {});
+    }
+
+    // addSprites(SpriteBatch&) gets called before the flush, so whatever it adds goes out in the same batch
+    template<typename AddSprites>
+    void draw(AddSprites&& addSprites) {
+        Profiler::Zone zone(m_profiler, "World::draw");
+        const float alpha = m_accumulator / TIME_STEP;
+
+        updateCamera(alpha);
+        const b2AABB view = getViewBounds();
+
+        BeginMode2D(m_camera);
+
+        m_staticGeometry.gather(m_worldID.get(), view, getStaticRevision());
+        m_staticGeometry.draw(m_sprites);
+        m_player.draw(m_sprites, alpha, m_facing);
+        m_bots.draw(m_sprites, alpha, view);
+        m_projectiles.draw(m_sprites, LAYER_PROJECTILES, SPRITE_PROJECTILE, alpha, view);
+        addSprites(m_sprites);
+        int batches = m_sprites.flush();
+
+        #ifdef ENABLE_DEBUG
+            batches += m_debugDraw.draw(m_worldID.get(), view);
+        #endif
+
+        EndMode2D();
+        m_profiler.countBatches(batches);
+
+        // Screen space from here on
+        #ifdef ENABLE_DEBUG
+            if (m_debugDraw.isEnabled()) {
+                m_player.writeDebugText(m_debugText);
+                m_debugText.draw(10, 10, RED);
+            }
+        #endif
+
+        m_profiler.drawHud();
+    }
+
+    // Follows the player sideways, stopping at the level's edges so nothing past the walls shows. The
+    // view doesn't move vertically, levels are one screen tall.
+    void updateCamera(const float alpha) {
+        const float halfView = WINDOW_WIDTH / 2.0f;
+        const float playerX = toPixels(m_player.getInterpolatedPosition(alpha)).x;
+
+        m_camera.target.x = std::min(std::max(playerX, halfView), m_levelWidth - halfView);
+        m_camera.target.y = WINDOW_HEIGHT / 2.0f;
+    }
+
+    // Camera's view rectangle, in meters
+    b2AABB getViewBounds() const {
+        const Vector2 topLeft = GetScreenToWorld2D({0.0f, 0.0f}, m_camera);
+        const Vector2 bottomRight = GetScreenToWorld2D(
+            {static_cast<float>(WINDOW_WIDTH), static_cast<float>(WINDOW_HEIGHT)},
+            m_camera);
+
+        return b2AABB{asB2(toMeters(asPixels(topLeft))), asB2(toMeters(asPixels(bottomRight)))};
+    }
+
+    // Pixels
+    void growLevelBounds(const float left, const float top, const float right, const float bottom) {
+        m_levelBounds.lowerBound = b2Min(m_levelBounds.lowerBound, {px2M(left), px2M(top)});
+        m_levelBounds.upperBound = b2Max(m_levelBounds.upperBound, {px2M(right), px2M(bottom)});
+    }
+
+    void unload() {
+        m_debugText.unload();
+        m_sprites.unload();
+        m_level.unload();
+        m_platforms.unload();
+        m_invisibleWalls.unload();
+        m_triggers.clear(); // Their handlers stay registered, but stale shape ids never match
+
+        m_player.unload();
+        m_bots.unload();
+        m_projectiles.unload();
+        m_worldID.reset();
+
+        TraceLog(LOG_INFO, "World destroyed.");
+    }
+
+    static void applyInput(const Player& player, const PlayerInput& input) {
+        if (input.right) {
+            player.moveRight();
+        }
+        else if (input.left) {
+            player.moveLeft();
+        }
+
+        if (input.jump) {
+            player.jump();
+        }
+    }
+
+    // Out the side of the player it last moved towards, keeping the player's own velocity
+    PoolHandle fireProjectile() {
+        const float offset = m_player.getSize().x / 2.0f + px2M(PROJECTILE_SIZE);
+        const b2Vec2 position = {m_player.getPosition().x + m_facing * offset, m_player.getPosition().y};
+        const b2Vec2 velocity = b2Add(b2Body_GetLinearVelocity(m_player.getBodyID()), {m_facing * PROJECTILE_SPEED, 0.0f});
+
+        return m_projectiles.spawn(m_worldID.get(), position, velocity, PROJECTILE_LIFETIME);
+    }
+
+    // Only bodies that moved this step show up, so nothing else gets touched
+    void handleMoveEvents() {
+        const b2BodyEvents events = b2World_GetBodyEvents(m_worldID.get());
+
+        for (int i = 0; i < events.moveCount; i++) {
+            const b2BodyMoveEvent& event = events.moveEvents[i];
+
+            if (B2_ID_EQUALS(event.bodyId, m_player.getBodyID())) {
+                m_player.onMove(event.transform.p);
+            }
+            else if (!m_bots.onMove(event)) {
+                m_projectiles.onMove(event);
+            }
+        }
+    }
+
+    // Handle events generated by sensor contact, foot sensors and anything else in m_sensors.
+    void handleSensorEvents() {
+        Profiler::Zone zone(m_profiler, "handleSensorEvents");
+        m_sensors.dispatch(m_worldID.get());
+    }
+};
+
+// Packs values least significant bit first. The buffer just grows, nothing's bounds checked on the way
+// out. Keep one around and clear it, it holds onto its storage.
+class BitWriter {
+    std::vector<uint8_t> m_bytes{};
+    uint64_t m_scratch{};
+    int m_scratchBits{};
+public:
+    void clear() {
+        m_bytes.clear();
+        m_scratch = 0;
+        m_scratchBits = 0;
+    }
+
+    void write(const uint32_t value, const int bits) {
+        assert(bits > 0 && bits <= 32 && (bits == 32 || value < (1u << bits)));
+
+        m_scratch |= static_cast<uint64_t>(value) << m_scratchBits;
+        m_scratchBits += bits;
+        while (m_scratchBits >= 8) {
+            m_bytes.push_back(static_cast<uint8_t>(m_scratch));
+            m_scratch >>= 8;
+            m_scratchBits -= 8;
+        }
+    }
+
+    void writeBool(const bool value) {
+        write(value ? 1u : 0u, 1);
+    }
+
+    // Zigzag so small negatives stay small, then a two bit size class. Anything within +-8 costs 6 bits
+    void writeDelta(const int32_t delta) {
+        const uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+
+        if (zigzag < (1u << 4)) {
+            write(0, 2);
+            write(zigzag, 4);
+        }
+        else if (zigzag < (1u << 10)) {
+            write(1, 2);
+            write(zigzag, 10);
+        }
+        else if (zigzag < (1u << 18)) {
+            write(2, 2);
+            write(zigzag, 18);
+        }
+        else {
+            write(3, 2);
+            write(zigzag, 32);
+        }
+    }
+
+    // Pads out to a byte boundary
+    void align() {
+        if (m_scratchBits > 0) {
+            write(0, 8 - m_scratchBits);
+        }
+    }
+
+    // Only on a byte boundary
+    void writeBytes(const std::vector<uint8_t>& bytes) {
+        assert(m_scratchBits == 0);
+        m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+    }
+
+    // Aligns first, so the last partial byte is in there
+    const std::vector<uint8_t>& finish() {
+        align();
+        return m_bytes;
+    }
+};
+
+// Reads back what BitWriter wrote. Running off the end sets a flag and reads zeros from then on, so check
+// isValid once at the end instead of after every read.
+class BitReader {
+    const uint8_t* m_data;
+    std::size_t m_size;
+    std::size_t m_offset{};
+    uint64_t m_scratch{};
+    int m_scratchBits{};
+    bool m_overflow{};
+public:
+    BitReader(const uint8_t* data, const std::size_t size) :
+        m_data(data),
+        m_size(size)
+    {}
+
+    uint32_t read(const int bits) {
+        assert(bits > 0 && bits <= 32);
+
+        while (m_scratchBits < bits) {
+            if (m_offset >= m_size) {
+                m_overflow = true;
+                return 0;
+            }
+            m_scratch |= static_cast<uint64_t>(m_data[m_offset++]) << m_scratchBits;
+            m_scratchBits += 8;
+        }
+
+        const uint32_t value = static_cast<uint32_t>(m_scratch & ((1ull << bits) - 1));
+        m_scratch >>= bits;
+        m_scratchBits -= bits;
+        return value;
+    }
+
+    bool readBool() {
+        return read(1) != 0;
+    }
+
+    int32_t readDelta() {
+        constexpr int sizes[4] = {4, 10, 18, 32};
+        const uint32_t zigzag = read(sizes[read(2)]);
+        return static_cast<int32_t>((zigzag >> 1) ^ (0u - (zigzag & 1u)));
+    }
+
+    void align() {
+        if (m_scratchBits % 8 != 0) {
+            read(m_scratchBits % 8);
+        }
+    }
+
+    bool isValid() const {
+        return !m_overflow;
+    }
+};
+
+// A player as it goes over the wire, fixed point at NET_POSITION_SCALE/NET_VELOCITY_SCALE
+struct QuantizedPlayer {
+    int32_t x;
+    int32_t y;
+    int32_t vx;
+    int32_t vy;
+};
+
+bool operator==(const QuantizedPlayer& a, const QuantizedPlayer& b) {
+    return a.x == b.x && a.y == b.y && a.vx == b.vx && a.vy == b.vy;
+}
+
+// Clamped well inside int32 so junk velocities can't overflow the conversion
+int32_t quantize(const float value, const float scale) {
+    constexpr float limit = static_cast<float>(1 << 30);
+    return static_cast<int32_t>(std::lround(std::min(std::max(value * scale, -limit), limit)));
+}
+
+QuantizedPlayer quantizePlayer(const b2Vec2 position, const b2Vec2 velocity) {
+    return {
+        quantize(position.x, NET_POSITION_SCALE),
+        quantize(position.y, NET_POSITION_SCALE),
+        quantize(velocity.x, NET_VELOCITY_SCALE),
+        quantize(velocity.y, NET_VELOCITY_SCALE)};
+}
+
+b2Vec2 dequantizePosition(const QuantizedPlayer& player) {
+    return {player.x / NET_POSITION_SCALE, player.y / NET_POSITION_SCALE};
+}
+
+b2Vec2 dequantizeVelocity(const QuantizedPlayer& player) {
+    return {player.vx / NET_VELOCITY_SCALE, player.vy / NET_VELOCITY_SCALE};
+}
+
+// Wraps instead of overflowing, and addition on the other end wraps back to exactly the same value
+int32_t wrappingDelta(const int32_t value, const int32_t baseline) {
+    return static_cast<int32_t>(static_cast<uint32_t>(value) - static_cast<uint32_t>(baseline));
+}
+
+int32_t applyDelta(const int32_t baseline, const int32_t delta) {
+    return static_cast<int32_t>(static_cast<uint32_t>(baseline) + static_cast<uint32_t>(delta));
+}
+
+// Every player against the same index in baseline, one bit for anyone who hasn't changed. Players past
+// the end of baseline (or all of them, with no baseline) go against zero.
+void writePlayerStates(
+    BitWriter& writer,
+    const std::vector<QuantizedPlayer>& players,
+    const std::vector<QuantizedPlayer>* baseline)
+{
+    writer.write(static_cast<uint32_t>(players.size()), 16);
+
+    for (std::size_t i = 0; i < players.size(); i++) {
+        const QuantizedPlayer base = baseline != nullptr && i < baseline->size() ? (*baseline)[i] : QuantizedPlayer{};
+        const QuantizedPlayer& player = players[i];
+
+        if (player == base) {
+            writer.writeBool(false);
+            continue;
+        }
+
+        writer.writeBool(true);
+        writer.writeDelta(wrappingDelta(player.x, base.x));
+        writer.writeDelta(wrappingDelta(player.y, base.y));
+        writer.writeDelta(wrappingDelta(player.vx, base.vx));
+        writer.writeDelta(wrappingDelta(player.vy, base.vy));
+    }
+}
+
+void readPlayerStates(
+    BitReader& reader,
+    std::vector<QuantizedPlayer>& players,
+    const std::vector<QuantizedPlayer>* baseline)
+{
+    players.resize(reader.read(16));
+
+    for (std::size_t i = 0; i < players.size(); i++) {
+        const QuantizedPlayer base = baseline != nullptr && i < baseline->size() ? (*baseline)[i] : QuantizedPlayer{};
+
+        if (!reader.readBool()) {
+            players[i] = base;
+            continue;
+        }
+
+        players[i].x = applyDelta(base.x, reader.readDelta());
+        players[i].y = applyDelta(base.y, reader.readDelta());
+        players[i].vx = applyDelta(base.vx, reader.readDelta());
+        players[i].vy = applyDelta(base.vy, reader.readDelta());
+    }
+}
+
+static_assert(NET_MAX_CONNECTIONS < (1 << 16), "Player counts and indices go over the wire as 16 bits");
+static_assert(NET_INPUT_REDUNDANCY >= 1 && NET_INPUT_REDUNDANCY <= 8, "Input counts go over the wire as 3 bits");
+
+// Packet layouts, bit packed, all sequence numbers and ticks start at 1 so 0 can mean none:
+//   Input (client to server): type 2, newest server tick received 32, newest input sequence 32,
+//     input count - 1 3, then that many INPUT_BITS inputs, newest first
+//   State (server to client): type 2, tick 32, baseline tick 32, the client's player index 16, sequence
+//     of the client's input that went into this tick 32, padding to a byte, then writePlayerStates
+//     against the baseline
+enum : uint32_t { NET_INPUT_PACKET = 0, NET_STATE_PACKET = 1 };
+
+// history is indexed by sequence number modulo its size
+void writeInputPacket(
+    BitWriter& writer,
+    const uint32_t ackTick,
+    const uint32_t newestSequence,
+    const std::vector<PlayerInput>& history)
+{
+    const uint32_t count = std::min(newestSequence, NET_INPUT_REDUNDANCY);
+    assert(count > 0 && history.size() >= NET_INPUT_REDUNDANCY);
+
+    writer.clear();
+    writer.write(NET_INPUT_PACKET, 2);
+    writer.write(ackTick, 32);
+    writer.write(newestSequence, 32);
+    writer.write(count - 1, 3);
+    for (uint32_t i = 0; i < count; i++) {
+        writer.write(packInput(history[(newestSequence - i) % history.size()]), INPUT_BITS);
+    }
+}
+
+// Client side copy of every player's state, for the last NET_STATE_HISTORY ticks received so the server
+// can delta against any of them. Packets older than the newest one are dropped.
+class ReplicatedPlayers {
+    std::vector<std::vector<QuantizedPlayer>> m_states = std::vector<std::vector<QuantizedPlayer>>(NET_STATE_HISTORY);
+    std::vector<uint32_t> m_ticks = std::vector<uint32_t>(NET_STATE_HISTORY, 0);
+    std::vector<QuantizedPlayer> m_decoded{};
+    uint32_t m_latestTick{};
+    uint32_t m_localIndex{};
+    uint32_t m_inputSequence{};
+public:
+    // False if it's malformed, stale or against a baseline that's already gone, nothing changes then
+    bool read(const uint8_t* data, const std::size_t size) {
+        BitReader reader(data, size);
+        if (reader.read(2) != NET_STATE_PACKET) return false;
+
+        const uint32_t tick = reader.read(32);
+        const uint32_t baselineTick = reader.read(32);
+        const uint32_t localIndex = reader.read(16);
+        const uint32_t inputSequence = reader.read(32);
+        reader.align();
+        if (!reader.isValid() || tick <= m_latestTick) return false;
+
+        const std::vector<QuantizedPlayer>* baseline = nullptr;
+        if (baselineTick != 0) {
+            baseline = find(baselineTick);
+            if (baseline == nullptr) return false;
+        }
+
+        readPlayerStates(reader, m_decoded, baseline);
+        if (!reader.isValid()) return false;
+
+        std::swap(m_states[tick % NET_STATE_HISTORY], m_decoded);
+        m_ticks[tick % NET_STATE_HISTORY] = tick;
+        m_latestTick = tick;
+        m_localIndex = localIndex;
+        m_inputSequence = inputSequence;
+        return true;
+    }
+
+    const std::vector<QuantizedPlayer>* find(const uint32_t tick) const {
+        const std::size_t slot = tick % NET_STATE_HISTORY;
+        return tick != 0 && m_ticks[slot] == tick ? &m_states[slot] : nullptr;
+    }
+
+    const std::vector<QuantizedPlayer>* latest() const {
+        return find(m_latestTick);
+    }
+
+    uint32_t getLatestTick() const {
+        return m_latestTick;
+    }
+
+    uint32_t getLocalIndex() const {
+        return m_localIndex;
+    }
+
+    // Which of our inputs went into the latest tick, 0 if the server had none of them queued
+    uint32_t getInputSequence() const {
+        return m_inputSequence;
+    }
+};
+
+// Server side of the protocol, with no sockets in it so benchmarks can drive it directly. Every connection
+// is a bot in the world. Inputs queue up per connection and one goes into each tick; anyone who runs dry
+// keeps going the way they were headed without jumping or firing. Each tick every connection gets the
+// whole player list delta compressed against the newest tick it's acknowledged, and since most clients
+// acknowledge the same few ticks, each baseline's delta is only encoded once per tick.
+class NetServer {
+    struct PendingInput {
+        uint32_t sequence;
+        PlayerInput input;
+    };
+
+    struct Connection {
+        std::size_t bot;
+        std::deque<PendingInput> pending;
+        PlayerInput lastInput;
+        uint32_t receivedSequence; // Newest input that's come in
+        uint32_t appliedSequence; // Input that went into this tick, 0 if there wasn't one
+        uint32_t ackTick;
+        uint32_t lastHeardTick;
+        std::vector<uint8_t> packet;
+    };
+
+    World& m_world;
+    std::vector<Connection> m_connections{};
+    std::vector<std::vector<QuantizedPlayer>> m_history = std::vector<std::vector<QuantizedPlayer>>(NET_STATE_HISTORY);
+    std::vector<uint32_t> m_historyTicks = std::vector<uint32_t>(NET_STATE_HISTORY, 0);
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> m_payloads{}; // This tick's, by baseline tick
+    std::size_t m_payloadCount{};
+    BitWriter m_writer{};
+    BitWriter m_payloadWriter{};
+    std::vector<float> m_focus{}; // Every connection's x in pixels, the level streams around all of them
+    uint32_t m_tick{};
+
+    bool isTimedOut(const Connection& connection) const {
+        return m_tick - connection.lastHeardTick > NET_TIMEOUT_TICKS;
+    }
+
+    const std::vector<uint8_t>& payloadFor(const uint32_t baselineTick) {
+        for (std::size_t i = 0; i < m_payloadCount; i++) {
+            if (m_payloads[i].first == baselineTick) return m_payloads[i].second;
+        }
+
+        m_payloadWriter.clear();
+        writePlayerStates(m_payloadWriter, m_history[m_tick % NET_STATE_HISTORY], getHistory(baselineTick));
+
+        if (m_payloadCount == m_payloads.size()) {
+            m_payloads.emplace_back();
+        }
+        auto& payload = m_payloads[m_payloadCount++];
+        payload.first = baselineTick;
+        payload.second = m_payloadWriter.finish();
+        return payload.second;
+    }
+public:
+    explicit NetServer(World& world) :
+        m_world(world)
+    {}
+
+    NetServer(const NetServer&) = delete;
+    NetServer& operator=(const NetServer&) = delete;
+
+    // The id addConnection hands out next, NET_MAX_CONNECTIONS if every one's taken. Timed out
+    // connections are free again, oldest id first.
+    std::size_t getFreeConnection() const {
+        for (std::size_t i = 0; i < m_connections.size(); i++) {
+            if (isTimedOut(m_connections[i])) return i;
+        }
+        return std::min(m_connections.size(), static_cast<std::size_t>(NET_MAX_CONNECTIONS));
+    }
+
+    // Pixels, like addBot. Takes getFreeConnection's id, so a timed out connection's slot and player get
+    // reused (respawned at the new spot) rather than piling up. The connection id is also the player's
+    // index in state packets.
+    std::size_t addConnection(const float centerX, const float centerY) {
+        const std::size_t id = getFreeConnection();
+        assert(id < NET_MAX_CONNECTIONS && "Assertion failed. No free connections, check getFreeConnection first.");
+
+        Connection connection{};
+        connection.lastInput = {false, false, false, false};
+        connection.lastHeardTick = m_tick;
+
+        if (id < m_connections.size()) {
+            connection.bot = m_connections[id].bot;
+            m_world.m_bots.respawn(connection.bot, centerX, centerY);
+            m_connections[id] = std::move(connection);
+        }
+        else {
+            connection.bot = m_world.addBot(centerX, centerY);
+            m_connections.push_back(std::move(connection));
+        }
+
+        return id;
+    }
+
+    // False if it isn't an input packet, it's malformed, or its sequence numbers can't be right. Nothing
+    // changes then.
+    bool onPacket(const std::size_t connectionId, const uint8_t* data, const std::size_t size) {
+        assert(connectionId < m_connections.size() && "Assertion failed. Packet for a connection that doesn't exist.");
+
+        BitReader reader(data, size);
+        if (reader.read(2) != NET_INPUT_PACKET) return false;
+
+        const uint32_t ackTick = reader.read(32);
+        const uint32_t newestSequence = reader.read(32);
+        const uint32_t count = reader.read(3) + 1;
+        PlayerInput inputs[NET_INPUT_REDUNDANCY];
+        for (uint32_t i = 0; i < count; i++) {
+            inputs[i] = unpackInput(static_cast<uint8_t>(reader.read(INPUT_BITS)));
+        }
+        if (!reader.isValid() || count > newestSequence) return false;
+
+        // Back after a timeout, most likely a restarted client counting from 1 again
+        Connection& connection = m_connections[connectionId];
+        if (isTimedOut(connection)) {
+            connection.pending.clear();
+            connection.receivedSequence = 0;
+            connection.ackTick = 0;
+        }
+        connection.lastHeardTick = m_tick;
+
+        if (ackTick > connection.ackTick && ackTick <= m_tick) {
+            connection.ackTick = ackTick;
+        }
+
+        // Oldest first, skipping anything we've already had
+        for (uint32_t i = count; i > 0; i--) {
+            const uint32_t sequence = newestSequence - (i - 1);
+            if (sequence > connection.receivedSequence) {
+                connection.pending.push_back({sequence, inputs[i - 1]});
+                connection.receivedSequence = sequence;
+            }
+        }
+
+        // Running ahead of the server, drop the oldest. The client gets corrected for them.
+        while (connection.pending.size() > NET_INPUT_BUFFER) {
+            connection.pending.pop_front();
+        }
+
+        return true;
+    }
+
+    // One world step, then a packet for every connection that's still around, see getPacket
+    void tick() {
+        m_tick++;
+
+        for (Connection& connection : m_connections) {
+            PlayerInput input = {false, false, false, false};
+            connection.appliedSequence = 0;
+
+            if (!isTimedOut(connection)) {
+                if (!connection.pending.empty()) {
+                    input = connection.pending.front().input;
+                    connection.appliedSequence = connection.pending.front().sequence;
+                    connection.lastInput = input;
+                    connection.pending.pop_front();
+                }
+                else {
+                    input = {connection.lastInput.left, connection.lastInput.right, false, false};
+                }
+            }
+
+            m_world.setBotInput(connection.bot, input);
+        }
+
+        // The world's own player has nobody driving it here and just stands at the spawn, so the level
+        // gets streamed around the connections too or they'd walk off the end of it
+        m_focus.clear();
+        for (const Connection& connection : m_connections) {
+            m_focus.push_back(m2Px(m_world.m_bots.getPosition(connection.bot).x));
+        }
+        m_world.setStreamingFocus(m_focus);
+        m_world.step({false, false, false, false});
+
+        std::vector<QuantizedPlayer>& players = m_history[m_tick % NET_STATE_HISTORY];
+        players.resize(m_connections.size());
+        for (std::size_t i = 0; i < m_connections.size(); i++) {
+            const std::size_t bot = m_connections[i].bot;
+            players[i] = quantizePlayer(m_world.m_bots.getPosition(bot), m_world.m_bots.getVelocity(bot));
+        }
+        m_historyTicks[m_tick % NET_STATE_HISTORY] = m_tick;
+
+        m_payloadCount = 0;
+        for (std::size_t i = 0; i < m_connections.size(); i++) {
+            Connection& connection = m_connections[i];
+            connection.packet.clear();
+            if (isTimedOut(connection)) continue;
+
+            const uint32_t baselineTick = getHistory(connection.ackTick) != nullptr ? connection.ackTick : 0;
+
+            m_writer.clear();
+            m_writer.write(NET_STATE_PACKET, 2);
+            m_writer.write(m_tick, 32);
+            m_writer.write(baselineTick, 32);
+            m_writer.write(static_cast<uint32_t>(i), 16);
+            m_writer.write(connection.appliedSequence, 32);
+            m_writer.align();
+            m_writer.writeBytes(payloadFor(baselineTick));
+            connection.packet = m_writer.finish();
+        }
+    }
+
+    // What tick sent this connection, empty if it's timed out
+    const std::vector<uint8_t>& getPacket(const std::size_t connectionId) const {
+        return m_connections[connectionId].packet;
+    }
+
+    // Null once it's dropped out of the history
+    const std::vector<QuantizedPlayer>* getHistory(const uint32_t tick) const {
+        const std::size_t slot = tick % NET_STATE_HISTORY;
+        return tick != 0 && m_historyTicks[slot] == tick ? &m_history[slot] : nullptr;
+    }
+
+    std::size_t getConnectionCount() const {
+        return m_connections.size();
+    }
+
+    uint32_t getTick() const {
+        return m_tick;
+    }
+};
+
+// IPv4 host and port, both in network byte order the way sockaddr_in has them
+struct NetAddress {
+    uint32_t host;
+    uint16_t port;
+};
+
+uint64_t addressKey(const NetAddress& address) {
+    return (static_cast<uint64_t>(address.host) << 16) | address.port;
+}
+
+// "host" or "host:port"
+bool resolveAddress(const char* text, NetAddress& address) {
+    #ifndef _WIN32
+        char host[256];
+        std::snprintf(host, sizeof(host), "%s", text);
+
+        uint16_t port = NET_DEFAULT_PORT;
+        char* colon = std::strrchr(host, ':');
+        if (colon != nullptr) {
+            *colon = '\0';
+            port = static_cast<uint16_t>(std::atoi(colon + 1));
+        }
+
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host, nullptr, &hints, &result) != 0 || result == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't resolve %s.", text);
+            return false;
+        }
+
+        address.host = reinterpret_cast<const sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+        address.port = htons(port);
+        freeaddrinfo(result);
+        return true;
+    #else
+        (void)text;
+        (void)address;
+        TraceLog(LOG_WARNING, "Networking isn't supported on this platform.");
+        return false;
+    #endif
+}
+
+// Non blocking UDP socket. Closed when it goes away.
+class UdpSocket {
+    int m_socket{-1};
+public:
+    UdpSocket() = default;
+
+    ~UdpSocket() {
+        close();
+    }
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // Port 0 picks any free one, which is what clients want
+    bool open(const uint16_t port) {
+        #ifndef _WIN32
+            m_socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+            if (m_socket < 0) {
+                TraceLog(LOG_WARNING, "Couldn't create a UDP socket.");
+                return false;
+            }
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_ANY);
+            address.sin_port = htons(port);
+            if (::bind(m_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+                ::fcntl(m_socket, F_SETFL, O_NONBLOCK) != 0)
+            {
+                TraceLog(LOG_WARNING, "Couldn't bind UDP port %d.", port);
+                close();
+                return false;
+            }
+
+            return true;
+        #else
+            (void)port;
+            TraceLog(LOG_WARNING, "Networking isn't supported on this platform.");
+            return false;
+        #endif
+    }
+
+    void close() {
+        #ifndef _WIN32
+            if (m_socket >= 0) {
+                ::close(m_socket);
+            }
+        #endif
+        m_socket = -1;
+    }
+
+    bool send(const NetAddress& to, const std::vector<uint8_t>& data) const {
+        #ifndef _WIN32
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = to.host;
+            address.sin_port = to.port;
+            return ::sendto(m_socket, data.data(), data.size(), 0, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) ==
+                static_cast<ssize_t>(data.size());
+        #else
+            (void)to;
+            (void)data;
+            return false;
+        #endif
+    }
+
+    // 0 when there's nothing waiting
+    int receive(std::vector<uint8_t>& buffer, NetAddress& from) const {
+        #ifndef _WIN32
+            sockaddr_in address{};
+            socklen_t addressSize = sizeof(address);
+            const ssize_t size = ::recvfrom(m_socket, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&address), &addressSize);
+            if (size <= 0) return 0;
+
+            from.host = address.sin_addr.s_addr;
+            from.port = address.sin_port;
+            return static_cast<int>(size);
+        #else
+            (void)buffer;
+            (void)from;
+            return 0;
+        #endif
+    }
+};
+
+// Client side of --connect. The local player is predicted: every step is simulated right away, sent to
+// the server and kept with a world snapshot. When the server's state for the last input it applied comes
+// back different from what was predicted for that input, the world goes back to that snapshot with the
+// player put where the server says, and everything since gets resimulated. Everybody else is drawn
+// straight from the server's state.
+class NetClient {
+    UdpSocket m_socket{};
+    NetAddress m_server{};
+    ReplicatedPlayers m_replica{};
+    std::vector<PlayerInput> m_inputs = std::vector<PlayerInput>(NET_PREDICTION_HISTORY);
+    std::vector<WorldSnapshot> m_predicted = std::vector<WorldSnapshot>(NET_PREDICTION_HISTORY);
+    std::vector<uint8_t> m_receiveBuffer = std::vector<uint8_t>(NET_MAX_PACKET);
+    BitWriter m_writer{};
+    uint32_t m_sequence{};
+    uint32_t m_reconciledTick{};
+    int m_corrections{};
+
+    bool isClose(const QuantizedPlayer& a, const QuantizedPlayer& b) const {
+        return std::abs(a.x - b.x) <= NET_RECONCILE_TOLERANCE &&
+               std::abs(a.y - b.y) <= NET_RECONCILE_TOLERANCE &&
+               std::abs(a.vx - b.vx) <= NET_RECONCILE_TOLERANCE &&
+               std::abs(a.vy - b.vy) <= NET_RECONCILE_TOLERANCE;
+    }
+
+    static void moveTo(WorldSnapshot& snapshot, const QuantizedPlayer& player) {
+        snapshot.player.body.transform.p = dequantizePosition(player);
+        snapshot.player.body.linearVelocity = dequantizeVelocity(player);
+        snapshot.player.position = snapshot.player.body.transform.p;
+    }
+
+    void predict(World& world, const PlayerInput& input) {
+        m_sequence++;
+        world.step(input);
+        m_inputs[m_sequence % NET_PREDICTION_HISTORY] = input;
+        world.saveSnapshot(m_predicted[m_sequence % NET_PREDICTION_HISTORY]);
+
+        writeInputPacket(m_writer, m_replica.getLatestTick(), m_sequence, m_inputs);
+        m_socket.send(m_server, m_writer.finish());
+    }
+
+    void reconcile(World& world) {
+        const std::vector<QuantizedPlayer>* players = m_replica.latest();
+        if (players == nullptr || m_replica.getLocalIndex() >= players->size()) return;
+
+        const QuantizedPlayer& server = (*players)[m_replica.getLocalIndex()];
+        const uint32_t sequence = m_replica.getInputSequence();
+
+        // That tick didn't line up with any of our steps, nothing to compare against
+        if (sequence == 0) return;
+
+        // Too far back to replay from, or a sequence we never sent. Just snap.
+        if (sequence > m_sequence || m_sequence - sequence >= NET_PREDICTION_HISTORY) {
+            WorldSnapshot& current = m_predicted[m_sequence % NET_PREDICTION_HISTORY];
+            world.saveSnapshot(current);
+            if (isClose(quantizePlayer(current.player.body.transform.p, current.player.body.linearVelocity), server)) return;
+
+            moveTo(current, server);
+            world.restoreSnapshot(current);
+            m_corrections++;
+            return;
+        }
+
+        WorldSnapshot& snapshot = m_predicted[sequence % NET_PREDICTION_HISTORY];
+        if (isClose(quantizePlayer(snapshot.player.body.transform.p, snapshot.player.body.linearVelocity), server)) return;
+
+        moveTo(snapshot, server);
+        world.restoreSnapshot(snapshot);
+        for (uint32_t resim = sequence + 1; resim <= m_sequence; resim++) {
+            world.step(m_inputs[resim % NET_PREDICTION_HISTORY]);
+            world.saveSnapshot(m_predicted[resim % NET_PREDICTION_HISTORY]);
+        }
+        m_corrections++;
+    }
+public:
+    // "host" or "host:port". Nothing's sent until the first step.
+    bool connect(const char* address) {
+        if (!resolveAddress(address, m_server) || !m_socket.open(0)) return false;
+
+        TraceLog(LOG_INFO, "Sending to %s.", address);
+        return true;
+    }
+
+    // Use instead of World::update. Takes in whatever's arrived, then steps with prediction.
+    void update(World& world, const float frameTime, const PlayerInput& input) {
+        NetAddress from{};
+        int size = 0;
+        while ((size = m_socket.receive(m_receiveBuffer, from)) > 0) {
+            if (addressKey(from) == addressKey(m_server)) {
+                m_replica.read(m_receiveBuffer.data(), static_cast<std::size_t>(size));
+            }
+        }
+
+        if (m_replica.getLatestTick() != m_reconciledTick) {
+            reconcile(world);
+            m_reconciledTick = m_replica.getLatestTick();
+        }
+
+        world.update(frameTime, input, [this, &world](const PlayerInput& stepInput) {
+            predict(world, stepInput);
+        });
+    }
+
+    // Everyone but us, from inside World::draw. There's no foot contact over the wire, so anyone not
+    // moving vertically counts as on the ground
+    void draw(const World& world, SpriteBatch& sprites) const {
+        const std::vector<QuantizedPlayer>* players = m_replica.latest();
+        if (players == nullptr) return;
+
+        constexpr Meters halfSize = toMeters(Pixels{PLAYER_SIZE, PLAYER_SIZE}) / 2.0f;
+        const b2AABB view = world.getViewBounds();
+
+        for (std::size_t i = 0; i < players->size(); i++) {
+            const Meters position = asMeters(dequantizePosition((*players)[i]));
+            if (i == m_replica.getLocalIndex() || !overlaps(view, position, halfSize)) continue;
+
+            const b2Vec2 velocity = dequantizeVelocity((*players)[i]);
+            const bool moving = std::fabs(velocity.x) > PLAYER_IDLE_SPEED;
+            const bool onGround = std::fabs(velocity.y) <= PLAYER_IDLE_SPEED;
+            const SpriteRegion frame = playerFrame(m2Px(position.x), moving, onGround);
+
+            const Pixels lower = toPixels(position - halfSize);
+            const Pixels upper = toPixels(position + halfSize);
+            sprites.add(LAYER_BOTS, frame, lower, upper, BLUE, velocity.x < 0.0f);
+        }
+    }
+
+    int getCorrectionCount() const {
+        return m_corrections;
+    }
+};
+
+// A player's state after a step, laid out the way the C API hands it out
+struct WorldObservation {
+    float positionX;
+    float positionY;
+    float velocityX;
+    float velocityY;
+    float onGround;
+};
+
+static_assert(sizeof(WorldObservation) == B2PM_OBSERVATION_SIZE * sizeof(float), "Observations go out as plain floats");
+
+// Lots of independent headless worlds stepped in parallel, for batch tuning and training runs. Worlds
+// are single threaded with no streaming thread, the parallelism is across worlds instead: a fixed pool
+// of threads takes world indices off a shared counter, and each world runs all of a call's steps in one
+// go before the next one's picked up. Input goes in per world, observations come out in one flat array.
+// Each world's state from right after creation is kept so it can be reset for the next episode.
+class WorldBatch {
+    using Policy = std::function<PlayerInput(std::size_t, const WorldObservation&)>;
+
+    std::vector<std::unique_ptr<World>> m_worlds{};
+    std::vector<WorldSnapshot> m_initialStates{};
+    std::vector<PlayerInput> m_inputs{};
+    std::vector<WorldObservation> m_observations{};
+
+    std::vector<std::thread> m_threads{};
+    std::mutex m_mutex{};
+    std::condition_variable m_wake{};
+    std::condition_variable m_finished{};
+    uint64_t m_job{}; // Goes up for every call to step, it's how workers know there's something new
+    int m_busy{}; // Workers still going on the current job
+    bool m_stopping{};
+    std::atomic<std::size_t> m_nextWorld{};
+    int m_stepCount{};
+    const Policy* m_policy{};
+
+    WorldObservation observe(const World& world) const {
+        const b2Vec2 position = world.m_player.getPosition();
+        const b2Vec2 velocity = b2Body_GetLinearVelocity(world.m_player.getBodyID());
+        return {position.x, position.y, velocity.x, velocity.y, world.m_player.isOnGround() ? 1.0f : 0.0f};
+    }
+
+    // Every thread including the caller's runs this until the worlds run out
+    void runJob() {
+        for (std::size_t i = m_nextWorld.fetch_add(1); i < m_worlds.size(); i = m_nextWorld.fetch_add(1)) {
+            World& world = *m_worlds[i];
+            for (int step = 0; step < m_stepCount; step++) {
+                world.step(m_policy != nullptr ? (*m_policy)(i, m_observations[i]) : m_inputs[i]);
+                m_observations[i] = observe(world);
+            }
+        }
+    }
+
+    void workerLoop() {
+        uint64_t lastJob = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this, lastJob] { return m_stopping || m_job != lastJob; });
+                if (m_stopping) return;
+                lastJob = m_job;
+            }
+
+            runJob();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busy == 0) {
+                m_finished.notify_one();
+            }
+        }
+    }
+
+    void run(const int stepCount, const Policy* policy) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stepCount = stepCount;
+            m_policy = policy;
+            m_nextWorld.store(0);
+            m_busy = static_cast<int>(m_threads.size());
+            m_job++;
+        }
+        m_wake.notify_all();
+
+        runJob();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [this] { return m_busy == 0; });
+    }
+public:
+    // Every world loads levelPath itself, null for the demo layout. Thread count includes the calling thread.
+    // Box2D only allows MAX_BATCH_WORLDS worlds at once counting any that already exist, isValid says
+    // whether they all got made. If they didn't there are none.
+    WorldBatch(const int worldCount, const int threadCount, const char* levelPath) {
+        const int count = std::min(worldCount, MAX_BATCH_WORLDS);
+        if (count < worldCount) {
+            TraceLog(LOG_WARNING, "Box2D allows %d worlds at once, asked for %d.", MAX_BATCH_WORLDS, worldCount);
+        }
+
+        m_worlds.reserve(count);
+        for (int i = 0; i < count; i++) {
+            m_worlds.push_back(std::make_unique<World>(World::loadLevelOrDemo(levelPath), 1, false));
+            m_worlds.back()->m_profiler.setTracing(false);
+
+            // Other worlds in the process count against Box2D's limit too, all or nothing
+            if (!m_worlds.back()->isValid()) {
+                TraceLog(LOG_WARNING, "Only %d of %d worlds could be created.", i, count);
+                for (auto& world : m_worlds) {
+                    world->unload();
+                }
+                m_worlds.clear();
+                return;
+            }
+        }
+
+        m_initialStates.resize(m_worlds.size());
+        m_inputs.resize(m_worlds.size(), {false, false, false, false});
+        m_observations.resize(m_worlds.size());
+        for (std::size_t i = 0; i < m_worlds.size(); i++) {
+            m_worlds[i]->saveSnapshot(m_initialStates[i]);
+            m_observations[i] = observe(*m_worlds[i]);
+        }
+
+        const int threads = std::max(1, std::min(threadCount, count));
+        for (int i = 1; i < threads; i++) {
+            m_threads.emplace_back(&WorldBatch::workerLoop, this);
+        }
+    }
+
+    WorldBatch(const WorldBatch&) = delete;
+    WorldBatch& operator=(const WorldBatch&) = delete;
+
+    ~WorldBatch() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+
+        for (auto& world : m_worlds) {
+            world->unload();
+        }
+    }
+
+    bool isValid() const {
+        return !m_worlds.empty();
+    }
+
+    void setInput(const std::size_t world, const PlayerInput& input) {
+        m_inputs[world] = input;
+    }
+
+    void step(const int stepCount) {
+        run(stepCount, nullptr);
+    }
+
+    // The policy gets called from every thread at once, with a world index and that world's latest observation
+    void step(const int stepCount, const Policy& policy) {
+        run(stepCount, &policy);
+    }
+
+    void reset(const std::size_t world) {
+        m_worlds[world]->restoreSnapshot(m_initialStates[world]);
+        m_observations[world] = observe(*m_worlds[world]);
+    }
+
+    const std::vector<WorldObservation>& getObservations() const {
+        return m_observations;
+    }
+
+    std::size_t size() const {
+        return m_worlds.size();
+    }
+
+    int getThreadCount() const {
+        return static_cast<int>(m_threads.size()) + 1;
+    }
+};
+
+// C API, see box2d_player_batch.h. The handle is the WorldBatch itself.
+static_assert(B2PM_INPUT_LEFT == INPUT_LEFT && B2PM_INPUT_RIGHT == INPUT_RIGHT &&
+              B2PM_INPUT_JUMP == INPUT_JUMP && B2PM_INPUT_FIRE == INPUT_FIRE, "C API input bits are the input log's");
+
+struct b2pmBatch {
+    WorldBatch batch;
+};
+
+// The C API's callers are scripts, so a bad world index gets a warning instead of only an assert
+static bool isBatchWorld(const b2pmBatch* batch, const int world) {
+    if (world >= 0 && static_cast<std::size_t>(world) < batch->batch.size()) return true;
+
+    TraceLog(LOG_WARNING, "No world %d in the batch, it has %d. Call ignored.", world, static_cast<int>(batch->batch.size()));
+    return false;
+}
+
+extern "C" {
+
+B2PM_API b2pmBatch* b2pmCreateBatch(const int worldCount, const int threadCount, const char* levelPath) {
+    if (worldCount <= 0 || worldCount > MAX_BATCH_WORLDS) {
+        TraceLog(LOG_WARNING, "World count has to be 1 to %d, got %d.", MAX_BATCH_WORLDS, worldCount);
+        return nullptr;
+    }
+
+    b2pmBatch* batch = new b2pmBatch{{worldCount, threadCount > 0 ? threadCount : defaultWorkerCount(), levelPath}};
+    if (!batch->batch.isValid()) {
+        delete batch;
+        return nullptr;
+    }
+    return batch;
+}
+
+B2PM_API void b2pmDestroyBatch(b2pmBatch* batch) {
+    delete batch;
+}
+
+B2PM_API int b2pmGetWorldCount(const b2pmBatch* batch) {
+    return static_cast<int>(batch->batch.size());
+}
+
+B2PM_API void b2pmSetInput(b2pmBatch* batch, const int world, const uint32_t inputBits) {
+    if (!isBatchWorld(batch, world)) return;
+    batch->batch.setInput(world, unpackInput(static_cast<uint8_t>(inputBits)));
+}
+
+B2PM_API void b2pmStep(b2pmBatch* batch, const int stepCount) {
+    batch->batch.step(stepCount);
+}
+
+B2PM_API void b2pmStepWithPolicy(b2pmBatch* batch, const int stepCount, b2pmPolicy* policy, void* context) {
+    batch->batch.step(stepCount, [policy, context](const std::size_t world, const WorldObservation& observation) {
+        return unpackInput(static_cast<uint8_t>(policy(static_cast<int>(world), &observation.positionX, context)));
+    });
+}
+
+B2PM_API void b2pmResetWorld(b2pmBatch* batch, const int world) {
+    if (!isBatchWorld(batch, world)) return;
+    batch->batch.reset(world);
+}
+
+B2PM_API int b2pmGetObservations(const b2pmBatch* batch, float* observations, const int capacity) {
+    if (observations == nullptr) return 0;
+
+    const std::vector<WorldObservation>& all = batch->batch.getObservations();
+    const int count = std::clamp(capacity / B2PM_OBSERVATION_SIZE, 0, static_cast<int>(all.size()));
+
+    std::memcpy(observations, all.data(), static_cast<std::size_t>(count) * sizeof(WorldObservation));
+    return count * B2PM_OBSERVATION_SIZE;
+}
+
+}
+
+// Offline level conversion, text <-> binary depending on the output extension
+int convertLevel(const char* inputPath, const char* outputPath) {
+    Level level;
+    if (!level.load(inputPath) || !level.save(outputPath)) {
+        return 1;
+    }
+
+    TraceLog(LOG_INFO, "Wrote %s.", outputPath);
+    return 0;
+}
+
+// Steps the same pile of dynamic boxes with 1, 2, 4... workers and prints the average b2World_Step
+// time for each, to see how the scheduler scales.
+int runThreadBenchmark(const int boxCount, const int stepCount) {
+    std::vector<int> workerCounts;
+    for (int workers = 1; workers < defaultWorkerCount(); workers *= 2) {
+        workerCounts.push_back(workers);
+    }
+    workerCounts.push_back(defaultWorkerCount());
+
+    std::printf("%d boxes, %d steps, %s ruleset\n", boxCount, stepCount, RULESET_NAME);
+    std::printf("workers  avg step ms  speedup\n");
+
+    double serialTime = 0.0;
+    for (const int workers : workerCounts) {
+        TaskScheduler scheduler(workers);
+        const b2WorldDef worldDef = World::makeWorldDef(scheduler);
+        const WorldHandle ownedWorld(b2CreateWorld(&worldDef));
+        const b2WorldId world = ownedWorld.get();
+
+        // Wide floor with a grid of boxes dropped on it, enough contacts to keep every worker busy
+        const int columns = static_cast<int>(std::sqrt(static_cast<float>(boxCount))) * 2;
+        PlatformStore floor;
+        floor.add({0.0f, 1.0f}, {columns * 0.5f, 0.5f}, DEFAULT_PLATFORM_FRICTION, WHITE, world);
+
+        for (int i = 0; i < boxCount; i++) {
+            b2BodyDef bodyDef = b2DefaultBodyDef();
+            bodyDef.type = b2_dynamicBody;
+            bodyDef.position = {(i % columns - columns / 2) * 0.5f, -(i / columns) * 0.5f};
+            const b2BodyId body = b2CreateBody(world, &bodyDef);
+
+            const b2Polygon box = b2MakeBox(0.2f, 0.2f);
+            const b2ShapeDef shapeDef = b2DefaultShapeDef();
+            b2CreatePolygonShape(body, &shapeDef, &box);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < stepCount; i++) {
+            b2World_Step(world, TIME_STEP, SUB_STEP);
+            scheduler.reset();
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double average = elapsed.count() / stepCount;
+        if (workers == 1) serialTime = average;
+        std::printf("%7d  %11.3f  %6.2fx\n", workers, average, serialTime / average);
+    }
+
+    return 0;
+}
+
+// Heap allocations so far. Only the regression suite's build (BOX2D_PLAYER_COUNT_ALLOCATIONS, see
+// CMakeLists.txt) counts them, it replaces operator new. Everything else gets -1. That's our side only,
+// Box2D and raylib allocate through malloc.
+#ifdef BOX2D_PLAYER_COUNT_ALLOCATIONS
+    std::atomic<int64_t> allocationCounter{0};
+
+    void* operator new(const std::size_t size) {
+        allocationCounter.fetch_add(1, std::memory_order_relaxed);
+        if (void* memory = std::malloc(size > 0 ? size : 1)) return memory;
+        throw std::bad_alloc();
+    }
+
+    void operator delete(void* memory) noexcept {
+        std::free(memory);
+    }
+
+    void operator delete(void* memory, std::size_t) noexcept {
+        std::free(memory);
+    }
+
+    int64_t allocationCount() {
+        return allocationCounter.load(std::memory_order_relaxed);
+    }
+#else
+    int64_t allocationCount() {
+        return -1;
+    }
+#endif
+
+// Peak resident memory for the process in KB, -1 where we don't know how
+long peakMemoryKb() {
+    #ifdef _WIN32
+        return -1;
+    #else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+
+        #ifdef __APPLE__
+            return usage.ru_maxrss / 1024; // Bytes on macOS, KB everywhere else
+        #else
+            return usage.ru_maxrss;
+        #endif
+    #endif
+}
+
+// Rows of platforms over a floor, all in one chunk so every platform is live in the broadphase. With
+// a chunk width it streams like a real level instead, the floor's cut up so each chunk has its own.
+// Benchmark levels are square-ish rows of platforms, bottom row first
+int benchmarkPlatformsPerRow(const int platformCount) {
+    return std::max(1, static_cast<int>(std::sqrt(static_cast<float>(platformCount))));
+}
+
+// Where generateBenchmarkLevel puts platform index. Indices past the last platform carry on the
+// same rows upwards
+Pixels benchmarkPlatformPosition(const int platformCount, const int index) {
+    const int perRow = benchmarkPlatformsPerRow(platformCount);
+    return {(index % perRow) * 200.0f + 100.0f, 380.0f - (index / perRow) * 90.0f};
+}
+
+Level generateBenchmarkLevel(const int platformCount, const float chunkWidth = 0.0f) {
+    const float levelWidth = benchmarkPlatformsPerRow(platformCount) * 200.0f;
+    const float floorWidth = chunkWidth > 0.0f ? chunkWidth : levelWidth;
+
+    std::vector<PlatformDesc> platforms;
+    platforms.reserve(platformCount + static_cast<std::size_t>(levelWidth / floorWidth) + 1);
+    for (float left = 0.0f; left < levelWidth; left += floorWidth) {
+        const float width = std::min(floorWidth, levelWidth - left);
+        platforms.push_back({left + width / 2.0f, WINDOW_HEIGHT - 20.0f, width, 50.0f, DEFAULT_PLATFORM_FRICTION, 0});
+    }
+
+    for (int i = 0; i < platformCount; i++) {
+        const Pixels position = benchmarkPlatformPosition(platformCount, i);
+        platforms.push_back({position.x, position.y, 130.0f, 30.0f, DEFAULT_PLATFORM_FRICTION, 0});
+    }
+
+    return Level::fromPlatforms(std::move(platforms), chunkWidth > 0.0f ? chunkWidth : levelWidth + 1.0f);
+}
+
+// Character index starts just above platform index, so everyone lands on something
+Pixels benchmarkSpawnPoint(const int platformCount, const int index) {
+    const Pixels platform = benchmarkPlatformPosition(platformCount, index);
+    return {platform.x, platform.y - 80.0f};
+}
+
+void addBenchmarkBots(World& world, const int platformCount, const int botCount) {
+    for (int i = 0; i < botCount; i++) {
+        const Pixels spawn = benchmarkSpawnPoint(platformCount, i);
+        world.addBot(spawn.x, spawn.y);
+    }
+}
+
+// Same script every run so results are comparable. Bots walk back and forth and hop now and then,
+// offset by index so they aren't all in lockstep.
+PlayerInput scriptedInput(const int step, const std::size_t botIndex) {
+    const int t = step + static_cast<int>(botIndex) * 17;
+    const bool goingRight = (t / 180) % 2 == 0;
+
+    return {!goingRight, goingRight, t % 45 == 0, false};
+}
+
+double percentile(std::vector<double> values, const double fraction) {
+    if (values.empty()) return 0.0;
+
+    const std::size_t index = std::min(values.size() - 1, static_cast<std::size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+double mean(const std::vector<double>& values) {
+    if (values.empty()) return 0.0;
+
+    double total = 0.0;
+    for (const double value : values) {
+        total += value;
+    }
+    return total / values.size();
+}
+
+// Times headless World::step calls and prints the usual report: per step timings, Box2D's own profile
+// breakdown, counters and memory use.
+class StepStats {
+    std::vector<double> m_stepTimes{};
+    b2Profile m_totals{};
+public:
+    void step(World& world, const PlayerInput& input) {
+        const auto start = std::chrono::steady_clock::now();
+        world.step(input);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        m_stepTimes.push_back(elapsed.count());
+
+        const b2Profile profile = b2World_GetProfile(world.m_worldID.get());
+        m_totals.step += profile.step;
+        m_totals.pairs += profile.pairs;
+        m_totals.collide += profile.collide;
+        m_totals.solve += profile.solve;
+        m_totals.sensors += profile.sensors;
+    }
+
+    void report(const World& world) const {
+        const b2Counters counters = b2World_GetCounters(world.m_worldID.get());
+        const double steps = static_cast<double>(std::max<std::size_t>(1, m_stepTimes.size()));
+
+        double total = 0.0;
+        for (const double time : m_stepTimes) {
+            total += time;
+        }
+
+        std::printf("step ms      mean %.3f  p50 %.3f  p99 %.3f  max %.3f\n",
+            total / steps,
+            percentile(m_stepTimes, 0.50),
+            percentile(m_stepTimes, 0.99),
+            percentile(m_stepTimes, 1.0));
+        std::printf("box2d ms     step %.3f  pairs %.3f  collide %.3f  solve %.3f  sensors %.3f (mean per step)\n",
+            m_totals.step / steps,
+            m_totals.pairs / steps,
+            m_totals.collide / steps,
+            m_totals.solve / steps,
+            m_totals.sensors / steps);
+        std::printf("counters     bodies %d  shapes %d  contacts %d  islands %d\n",
+            counters.bodyCount,
+            counters.shapeCount,
+            counters.contactCount,
+            counters.islandCount);
+        std::printf("memory       box2d %.1f KB  peak resident %ld KB\n", counters.byteCount / 1024.0, peakMemoryKb());
+    }
+};
+
+// Headless run, no window and no drawing. Builds a generated level with scripted bots.
+int runBenchmark(const int platformCount, const int botCount, const int stepCount, const int workerCount) {
+    World world(generateBenchmarkLevel(platformCount), workerCount);
+    addBenchmarkBots(world, platformCount, botCount);
+
+    StepStats stats;
+    for (int step = 0; step < stepCount; step++) {
+        for (std::size_t i = 0; i < world.m_bots.size(); i++) {
+            world.setBotInput(i, scriptedInput(step, i));
+        }
+
+        stats.step(world, scriptedInput(step, world.m_bots.size()));
+    }
+
+    std::printf("platforms %d, players %d, steps %d, workers %d, %s ruleset\n", platformCount, botCount + 1, stepCount, workerCount, RULESET_NAME);
+    stats.report(world);
+
+    world.unload();
+    return 0;
+}
+
+// Ground checks for a crowd, foot sensors against the platform grid, with the same level, bots and
+// input for both. Times whole world steps, since the sensors' cost is spread over Box2D's step and our
+// event handling. The sensor run also has a grid asked the same questions on the side, untimed, to
+// show how often the two agree.
+int runGroundBenchmark(const int characterCount, const int stepCount, const int workerCount) {
+    constexpr int platformCount = 1000;
+
+    std::printf("characters %d, platforms %d, steps %d, workers %d, %s ruleset\n", characterCount, platformCount, stepCount, workerCount, RULESET_NAME);
+
+    for (const auto groundCheck : {PlayerSystem::GroundCheck::Sensor, PlayerSystem::GroundCheck::Query}) {
+        World world(generateBenchmarkLevel(platformCount), workerCount);
+        world.m_bots.setGroundCheck(groundCheck);
+        addBenchmarkBots(world, platformCount, characterCount);
+
+        StepStats stats;
+        PlatformGrid check;
+        long checks = 0;
+        long agreed = 0;
+        for (int step = 0; step < stepCount; step++) {
+            for (std::size_t i = 0; i < world.m_bots.size(); i++) {
+                world.setBotInput(i, scriptedInput(step, i));
+            }
+
+            stats.step(world, scriptedInput(step, world.m_bots.size()));
+
+            if (groundCheck == PlayerSystem::GroundCheck::Sensor) {
+                check.update(world.m_worldID.get(), world.getLevelBounds(), world.getStaticRevision());
+                for (std::size_t i = 0; i < world.m_bots.size(); i++) {
+                    const bool grounded = check.overlapsAny(Player::footBounds(world.m_bots.getPosition(i)));
+                    agreed += grounded == world.m_bots.isOnGround(i);
+                    checks++;
+                }
+            }
+        }
+
+        if (groundCheck == PlayerSystem::GroundCheck::Sensor) {
+            std::printf("\nfoot sensors\n");
+            stats.report(world);
+            std::printf("agreement    grid matched the sensors on %.2f%% of %ld checks\n", checks > 0 ? 100.0 * agreed / checks : 100.0, checks);
+        }
+        else {
+            std::printf("\nplatform grid, %d static boxes\n", static_cast<int>(world.m_ground.size()));
+            stats.report(world);
+        }
+
+        world.unload();
+    }
+
+    return 0;
+}
+
+// Spawns and despawns projectiles as fast as asked, to check the pool holds up. Resident memory shouldn't
+// move at all once every slot has been through once.
+int runSpawnBenchmark(const int perStep, const int stepCount, const int workerCount) {
+    constexpr uint32_t lifetime = 30;
+
+    World world(nullptr, workerCount);
+    StepStats stats;
+    long warmMemoryKb = 0;
+    long spawned = 0;
+    long failed = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < stepCount; step++) {
+        for (int i = 0; i < perStep; i++) {
+            const b2Vec2 position = {px2M(50.0f + static_cast<float>((step * 7 + i * 37) % 540)), px2M(100.0f)};
+            const b2Vec2 velocity = {static_cast<float>(i % 7) - 3.0f, 0.0f};
+
+            if (world.m_projectiles.isAlive(world.m_projectiles.spawn(world.m_worldID.get(), position, velocity, lifetime))) {
+                spawned++;
+            }
+            else {
+                failed++;
+            }
+        }
+
+        stats.step(world, {false, false, false, false});
+        if (step == static_cast<int>(lifetime) * 2) {
+            warmMemoryKb = peakMemoryKb();
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("spawn %d per step, %d steps, lifetime %u steps, pool %d\n",
+        perStep,
+        stepCount,
+        lifetime,
+        static_cast<int>(world.m_projectiles.capacity()));
+    std::printf("spawned      %ld (%.0f per second), %ld failed with the pool full\n",
+        spawned,
+        spawned / elapsed.count(),
+        failed);
+    stats.report(world);
+    std::printf("memory       peak resident %ld KB after warm up, %ld KB at the end\n", warmMemoryKb, peakMemoryKb());
+
+    world.unload();
+    return 0;
+}
+
+// Rollback load test on the --bench level. Saves a snapshot after every step, and every so often rolls
+// back a few steps and resimulates them with the same input, the way a netcode correction would. Reports
+// what saving and restoring cost next to the step itself, and how far the player ended up from where it
+// was before the rollback, which is Box2D's warm starting not being part of the snapshot.
+int runSnapshotBenchmark(const int botCount, const int stepCount, const int rollbackSteps, const int workerCount) {
+    constexpr int platformCount = 400;
+    constexpr int rollbackInterval = 30;
+
+    World world(generateBenchmarkLevel(platformCount), workerCount);
+    addBenchmarkBots(world, platformCount, botCount);
+
+    // Projectiles too so the pool gets exercised, the player fires every half second
+    const auto input = [&world](const int step) {
+        for (std::size_t i = 0; i < world.m_bots.size(); i++) {
+            world.setBotInput(i, scriptedInput(step, i));
+        }
+
+        PlayerInput playerInput = scriptedInput(step, world.m_bots.size());
+        playerInput.fire = step % 30 == 0;
+        return playerInput;
+    };
+
+    std::vector<WorldSnapshot> history(rollbackSteps + 1);
+    std::vector<double> saveTimes;
+    std::vector<double> restoreTimes;
+    std::vector<double> rollbackTimes;
+    StepStats stats;
+    float maxDrift = 0.0f;
+
+    for (int step = 0; step < stepCount; step++) {
+        stats.step(world, input(step));
+
+        auto start = std::chrono::steady_clock::now();
+        world.saveSnapshot(history[step % history.size()]);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        saveTimes.push_back(elapsed.count());
+
+        if (step < rollbackSteps || step % rollbackInterval != 0) continue;
+
+        const b2Vec2 expected = b2Body_GetPosition(world.m_player.getBodyID());
+
+        start = std::chrono::steady_clock::now();
+        world.restoreSnapshot(history[(step - rollbackSteps) % history.size()]);
+        elapsed = std::chrono::steady_clock::now() - start;
+        restoreTimes.push_back(elapsed.count());
+
+        // Resimulated steps overwrite their own history the same as the first time through
+        for (int resim = step - rollbackSteps + 1; resim <= step; resim++) {
+            world.step(input(resim));
+            world.saveSnapshot(history[resim % history.size()]);
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        rollbackTimes.push_back(elapsed.count());
+
+        maxDrift = std::max(maxDrift, b2Length(b2Sub(b2Body_GetPosition(world.m_player.getBodyID()), expected)));
+    }
+
+    std::printf("platforms %d, players %d, steps %d, rollback %d steps every %d, workers %d, %s ruleset\n",
+        platformCount,
+        botCount + 1,
+        stepCount,
+        rollbackSteps,
+        rollbackInterval,
+        workerCount,
+        RULESET_NAME);
+    stats.report(world);
+    std::printf("save us      mean %.2f  p50 %.2f  p99 %.2f  max %.2f\n",
+        mean(saveTimes),
+        percentile(saveTimes, 0.50),
+        percentile(saveTimes, 0.99),
+        percentile(saveTimes, 1.0));
+    std::printf("restore us   mean %.2f  p50 %.2f  p99 %.2f  max %.2f (%d rollbacks)\n",
+        mean(restoreTimes),
+        percentile(restoreTimes, 0.50),
+        percentile(restoreTimes, 0.99),
+        percentile(restoreTimes, 1.0),
+        static_cast<int>(restoreTimes.size()));
+    std::printf("rollback ms  mean %.3f  max %.3f (restore plus resimulating)\n",
+        mean(rollbackTimes) / 1000.0,
+        percentile(rollbackTimes, 1.0) / 1000.0);
+    std::printf("snapshot     %.1f KB, player drift after resimulating %.6f m max\n",
+        history[0].byteCount() / 1024.0,
+        maxDrift);
+
+    world.unload();
+    return 0;
+}
+
+// Headless authoritative server, ticks at the ruleset's step rate until it's killed. Anyone who sends an
+// input packet gets a player. Logs tick time and bandwidth every ten seconds.
+int runServer(const uint16_t port, const char* levelPath, const int workerCount) {
+    UdpSocket socket;
+    if (!socket.open(port)) return 1;
+
+    World world(levelPath, workerCount);
+    NetServer server(world);
+    std::unordered_map<uint64_t, std::size_t> connections;
+    std::vector<NetAddress> addresses;
+    std::vector<uint8_t> buffer(NET_MAX_PACKET);
+    std::vector<double> tickTimes;
+    uint64_t bytesSent = 0;
+    uint64_t packetsSent = 0;
+
+    TraceLog(LOG_INFO, "Serving on UDP port %d, %s ruleset.", port, RULESET_NAME);
+
+    const auto tickLength = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(TIME_STEP));
+    auto nextTick = std::chrono::steady_clock::now();
+    while (true) {
+        NetAddress from{};
+        int size = 0;
+        while ((size = socket.receive(buffer, from)) > 0) {
+            auto found = connections.find(addressKey(from));
+            if (found == connections.end()) {
+                const std::size_t id = server.getFreeConnection();
+                if (id >= NET_MAX_CONNECTIONS) continue;
+
+                // A timed out player's slot, whoever had it is a stranger now if they come back
+                if (id < addresses.size()) {
+                    connections.erase(addressKey(addresses[id]));
+                    addresses[id] = from;
+                    TraceLog(LOG_INFO, "Player %d timed out, slot reused.", static_cast<int>(id));
+                }
+                else {
+                    addresses.push_back(from);
+                }
+
+                // Spread out over the first screen so nobody spawns inside anybody else
+                const float x = 105.0f + (id % 7) * 75.0f;
+                const float y = 300.0f - ((id / 7) % 4) * 65.0f;
+                found = connections.emplace(addressKey(from), server.addConnection(x, y)).first;
+                TraceLog(LOG_INFO, "Player %d connected.", static_cast<int>(id));
+            }
+
+            server.onPacket(found->second, buffer.data(), static_cast<std::size_t>(size));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        server.tick();
+        for (std::size_t i = 0; i < server.getConnectionCount(); i++) {
+            const std::vector<uint8_t>& packet = server.getPacket(i);
+            if (!packet.empty() && socket.send(addresses[i], packet)) {
+                bytesSent += packet.size();
+                packetsSent++;
+            }
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        tickTimes.push_back(elapsed.count());
+
+        if (tickTimes.size() == static_cast<std::size_t>(10.0f / TIME_STEP)) {
+            TraceLog(LOG_INFO, "Tick %u, %d players, tick ms mean %.3f p99 %.3f, %.0f bytes per packet.",
+                server.getTick(),
+                static_cast<int>(server.getConnectionCount()),
+                mean(tickTimes),
+                percentile(tickTimes, 0.99),
+                packetsSent > 0 ? static_cast<double>(bytesSent) / packetsSent : 0.0);
+            tickTimes.clear();
+            bytesSent = 0;
+            packetsSent = 0;
+        }
+
+        // Same idea as World::update, way behind means drop the backlog rather than burst
+        nextTick += tickLength;
+        const auto now = std::chrono::steady_clock::now();
+        if (now > nextTick + tickLength * MAX_STEPS_PER_FRAME) {
+            nextTick = now;
+        }
+        std::this_thread::sleep_until(nextTick);
+    }
+}
+
+// Server and clients in one process with the sockets cut out, so it measures the protocol and not the
+// network. Every client sends scripted input each tick and decodes every state packet it gets, and a
+// fixed share of packets each way are dropped to keep the baselines honest. Reports server tick time
+// with encoding, bytes per player per tick against a full uncompressed state, and checks every decoded
+// state matches what the server sent.
+int runNetBenchmark(const int clientCount, const int stepCount, const int workerCount) {
+    constexpr int platformCount = 400;
+    constexpr uint32_t lossPercent = 5;
+
+    struct SimulatedClient {
+        ReplicatedPlayers replica{};
+        std::vector<PlayerInput> inputs = std::vector<PlayerInput>(NET_INPUT_REDUNDANCY);
+        BitWriter writer{};
+        uint32_t sequence{};
+    };
+
+    // Streamed in chunks, with clients spread over all of them, so the server has to keep ground under
+    // players a long way from its own
+    World world(generateBenchmarkLevel(platformCount, CHUNK_WIDTH), workerCount);
+    NetServer server(world);
+    std::vector<SimulatedClient> clients(clientCount);
+    for (int i = 0; i < clientCount; i++) {
+        const Pixels spawn = benchmarkSpawnPoint(platformCount, i);
+        server.addConnection(spawn.x, spawn.y);
+    }
+
+    // Same losses every run
+    uint32_t random = 12345;
+    const auto dropped = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return (random >> 16) % 100 < lossPercent;
+    };
+
+    std::vector<double> tickTimes;
+    uint64_t stateBytes = 0;
+    uint64_t inputBytes = 0;
+    long delivered = 0;
+    long lost = 0;
+    long rejected = 0;
+    long mismatched = 0;
+
+    for (int step = 0; step < stepCount; step++) {
+        for (std::size_t i = 0; i < clients.size(); i++) {
+            SimulatedClient& client = clients[i];
+            client.sequence++;
+            client.inputs[client.sequence % client.inputs.size()] = scriptedInput(step, i);
+            writeInputPacket(client.writer, client.replica.getLatestTick(), client.sequence, client.inputs);
+
+            const std::vector<uint8_t>& packet = client.writer.finish();
+            inputBytes += packet.size();
+            if (!dropped()) {
+                server.onPacket(i, packet.data(), packet.size());
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        server.tick();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        tickTimes.push_back(elapsed.count());
+
+        for (std::size_t i = 0; i < clients.size(); i++) {
+            const std::vector<uint8_t>& packet = server.getPacket(i);
+            stateBytes += packet.size();
+            if (dropped()) {
+                lost++;
+                continue;
+            }
+
+            SimulatedClient& client = clients[i];
+            if (!client.replica.read(packet.data(), packet.size())) {
+                rejected++;
+                continue;
+            }
+
+            delivered++;
+            if (*client.replica.latest() != *server.getHistory(server.getTick())) {
+                mismatched++;
+            }
+        }
+    }
+
+    // What one packet would be with no baseline at all, and with no quantization or bit packing
+    BitWriter full;
+    writePlayerStates(full, *server.getHistory(server.getTick()), nullptr);
+    const double packets = static_cast<double>(std::max<long>(1, static_cast<long>(stepCount) * clientCount));
+    const double statePerPacket = stateBytes / packets;
+
+    std::printf("clients %d, steps %d, %u%% loss each way, workers %d, %s ruleset\n",
+        clientCount,
+        stepCount,
+        lossPercent,
+        workerCount,
+        RULESET_NAME);
+    std::printf("tick ms      mean %.3f  p50 %.3f  p99 %.3f  max %.3f (step plus encoding for every client)\n",
+        mean(tickTimes),
+        percentile(tickTimes, 0.50),
+        percentile(tickTimes, 0.99),
+        percentile(tickTimes, 1.0));
+    std::printf("down         %.1f bytes per packet, %.2f bytes per player, %.1f kbit/s per client\n",
+        statePerPacket,
+        statePerPacket / std::max(1, clientCount),
+        statePerPacket * 8.0 / TIME_STEP / 1000.0);
+    std::printf("full state   %d bytes without a baseline, %d as raw floats\n",
+        static_cast<int>(full.finish().size()),
+        static_cast<int>(clientCount * 4 * sizeof(float)));
+    std::printf("up           %.1f bytes per packet, %.1f kbit/s per client\n",
+        inputBytes / packets,
+        inputBytes / packets * 8.0 / TIME_STEP / 1000.0);
+    std::printf("decode       %ld delivered, %ld lost, %ld rejected, %ld mismatched\n", delivered, lost, rejected, mismatched);
+
+    // Anyone under the floor fell through a chunk the server didn't have
+    int fell = 0;
+    for (std::size_t i = 0; i < server.getConnectionCount(); i++) {
+        if (m2Px(world.m_bots.getPosition(i).y) > WINDOW_HEIGHT) fell++;
+    }
+    std::printf("streaming    %d chunks, %d players fell through the level\n", static_cast<int>(world.m_level.getChunkCount()), fell);
+
+    world.unload();
+    return mismatched == 0 && fell == 0 ? 0 : 1;
+}
+
+// Steps a batch of demo level worlds with scripted input at every thread count from 1 up, doubling, and
+// reports aggregate steps per second for each so the scaling's easy to see.
+int runBatchBenchmark(const int worldCount, const int stepCount, const int maxThreads) {
+    constexpr int stepsPerCall = 60;
+
+    std::printf("worlds %d, steps %d per world, %s ruleset\n", worldCount, stepCount, RULESET_NAME);
+
+    double singleThreaded = 0.0;
+    for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+        WorldBatch batch(worldCount, threads, nullptr);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < stepCount; step += stepsPerCall) {
+            for (std::size_t i = 0; i < batch.size(); i++) {
+                batch.setInput(i, scriptedInput(step, i));
+            }
+            batch.step(std::min(stepsPerCall, stepCount - step));
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double stepsPerSecond = static_cast<double>(batch.size()) * stepCount / elapsed.count();
+        if (threads == 1) {
+            singleThreaded = stepsPerSecond;
+        }
+        std::printf("threads %3d  %10.0f steps/s  %8.0f per world  %.2fx\n",
+            batch.getThreadCount(),
+            stepsPerSecond,
+            stepsPerSecond / batch.size(),
+            stepsPerSecond / singleThreaded);
+
+        if (threads >= maxThreads) break;
+    }
+
+    std::printf("memory       peak resident %ld KB\n", peakMemoryKb());
+    return 0;
+}
+
+// One scripted scene for the regression suite, see bench/scenes.txt
+struct BenchScene {
+    char name[32];
+    int platformCount; // Generated level like --bench, 0 for the demo layout
+    int botCount;
+    int triggerCount;
+    int frameCount;
+};
+
+// One scene per line, # for comments:
+//   <name> <demo | platform count> <bots> <triggers> <frames>
+bool loadBenchScenes(const char* path, std::vector<BenchScene>& scenes) {
+    std::FILE* file = std::fopen(path, "r");
+    if (file == nullptr) {
+        TraceLog(LOG_WARNING, "Couldn't open scene file %s.", path);
+        return false;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    bool ok = true;
+
+    while (std::fgets(line, sizeof(line), file) != nullptr) {
+        lineNumber++;
+
+        BenchScene scene{};
+        char level[32] = {};
+        if (std::sscanf(line, " %31s", scene.name) != 1 || scene.name[0] == '#') continue;
+
+        const bool parsed = std::sscanf(line, " %*s %31s %d %d %d", level, &scene.botCount, &scene.triggerCount, &scene.frameCount) == 4;
+        const bool demo = std::strcmp(level, "demo") == 0;
+        scene.platformCount = demo ? 0 : std::atoi(level);
+
+        if (!parsed || (!demo && scene.platformCount <= 0) || scene.botCount < 0 || scene.triggerCount < 0 || scene.frameCount <= 0) {
+            TraceLog(LOG_WARNING, "Scene file %s, line %d: couldn't parse \"%s\".", path, lineNumber, scene.name);
+            ok = false;
+            break;
+        }
+
+        scenes.push_back(scene);
+    }
+
+    std::fclose(file);
+    return ok && !scenes.empty();
+}
+
+// The regression suite's results, and its baselines. One "<scene> <metric> <value>" per line so they
+// diff and grep well, and a results file can be copied straight over a baseline.
+class BenchResults {
+    struct Metric {
+        char scene[32];
+        char name[32];
+        double value;
+    };
+
+    std::vector<Metric> m_metrics{};
+
+    const Metric* find(const char* scene, const char* name) const {
+        for (const auto& metric : m_metrics) {
+            if (std::strcmp(metric.scene, scene) == 0 && std::strcmp(metric.name, name) == 0) return &metric;
+        }
+        return nullptr;
+    }
+public:
+    void add(const char* scene, const char* name, const double value) {
+        Metric metric{};
+        std::snprintf(metric.scene, sizeof(metric.scene), "%s", scene);
+        std::snprintf(metric.name, sizeof(metric.name), "%s", name);
+        metric.value = value;
+        m_metrics.push_back(metric);
+    }
+
+    bool load(const char* path) {
+        std::FILE* file = std::fopen(path, "r");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open bench results %s.", path);
+            return false;
+        }
+
+        m_metrics.clear();
+        char line[256];
+        while (std::fgets(line, sizeof(line), file) != nullptr) {
+            Metric metric{};
+            if (std::sscanf(line, " %31s %31s %lf", metric.scene, metric.name, &metric.value) == 3 && metric.scene[0] != '#') {
+                m_metrics.push_back(metric);
+            }
+        }
+
+        std::fclose(file);
+        return true;
+    }
+
+    bool save(const char* path) const {
+        std::FILE* file = std::fopen(path, "w");
+        if (file == nullptr) {
+            TraceLog(LOG_WARNING, "Couldn't open %s for writing.", path);
+            return false;
+        }
+
+        std::fprintf(file, "# Box2DPlayer --bench-suite, %s ruleset. <scene> <metric> <value>, times in ms\n", RULESET_NAME);
+        for (const auto& metric : m_metrics) {
+            std::fprintf(file, "%s %s %.6g\n", metric.scene, metric.name, metric.value);
+        }
+
+        const bool ok = std::ferror(file) == 0;
+        std::fclose(file);
+        return ok;
+    }
+
+    // Prints every metric that's worse than its baseline allows and returns how many. Lower is better
+    // for all of them. Metrics the baseline doesn't have count too, a new or renamed scene shouldn't go
+    // unchecked until someone saves a baseline for it. Ones this run didn't measure just get a warning.
+    int compare(const BenchResults& baseline) const {
+        int regressions = 0;
+
+        for (const auto& metric : m_metrics) {
+            const Metric* base = baseline.find(metric.scene, metric.name);
+            if (base == nullptr) {
+                std::printf("UNCHECKED    %s %s %.4g, not in the baseline\n", metric.scene, metric.name, metric.value);
+                regressions++;
+                continue;
+            }
+
+            const bool isTime = std::strstr(metric.name, "_ms") != nullptr;
+            const double limit = base->value * (1.0 + BENCH_TOLERANCE) + (isTime ? BENCH_TIME_SLACK : BENCH_ALLOCATION_SLACK);
+            if (metric.value > limit) {
+                std::printf("REGRESSION   %s %s %.4g, baseline %.4g\n", metric.scene, metric.name, metric.value, base->value);
+                regressions++;
+            }
+        }
+
+        for (const auto& base : baseline.m_metrics) {
+            if (find(base.scene, base.name) == nullptr) {
+                TraceLog(LOG_WARNING, "Baseline has %s %s but this run didn't measure it.", base.scene, base.name);
+            }
+        }
+
+        return regressions;
+    }
+};
+
+// Plays a scene through World::update and World::draw a frame at a time like the game does, with
+// every frame exactly one step long so runs line up. Bots and the player follow scriptedInput, and
+// triggers are spread evenly over the level. Draw only gets timed with a window to draw into.
+void runBenchScene(const BenchScene& scene, const bool drawing, BenchResults& results) {
+    using Clock = std::chrono::steady_clock;
+
+    // Single threaded Box2D so the numbers don't move with whatever else the machine's doing
+    World world(scene.platformCount > 0 ? generateBenchmarkLevel(scene.platformCount) : World::loadLevelOrDemo(nullptr), 1);
+
+    addBenchmarkBots(world, scene.platformCount, scene.botCount);
+
+    int triggerEvents = 0;
+    if (scene.triggerCount > 0) {
+        // Same rows as generateBenchmarkLevel, from a row above the top one down to the bottom of the window
+        const int perRow = benchmarkPlatformsPerRow(scene.platformCount);
+        const int rows = (scene.platformCount + perRow - 1) / perRow;
+        const float top = scene.platformCount > 0 ? benchmarkPlatformPosition(scene.platformCount, rows * perRow).y : 0.0f;
+        const float spacing = std::sqrt(world.m_levelWidth * (WINDOW_HEIGHT - top) / scene.triggerCount);
+        const int columns = std::max(1, static_cast<int>(world.m_levelWidth / spacing));
+
+        for (int i = 0; i < scene.triggerCount; i++) {
+            const float x = (i % columns + 0.5f) * spacing;
+            const float y = top + (i / columns + 0.5f) * spacing;
+            world.addTrigger(x, y, BENCH_TRIGGER_SIZE, BENCH_TRIGGER_SIZE, [&triggerEvents](b2ShapeId, const bool began) {
+                if (began) triggerEvents++;
+            });
+        }
+    }
+
+    std::vector<double> updateTimes;
+    std::vector<double> drawTimes;
+    std::vector<double> frameTimes;
+    updateTimes.reserve(scene.frameCount);
+    drawTimes.reserve(scene.frameCount);
+    frameTimes.reserve(scene.frameCount);
+    int64_t allocations = 0;
+
+    for (int frame = -BENCH_WARMUP_FRAMES; frame < scene.frameCount; frame++) {
+        const int step = frame + BENCH_WARMUP_FRAMES;
+        for (std::size_t i = 0; i < world.m_bots.size(); i++) {
+            world.setBotInput(i, scriptedInput(step, i));
+        }
+        const PlayerInput input = scriptedInput(step, world.m_bots.size());
+        const int64_t allocationsBefore = allocationCount();
+
+        const auto start = Clock::now();
+        world.update(TIME_STEP, input);
+        const std::chrono::duration<double, std::milli> updateTime = Clock::now() - start;
+
+        std::chrono::duration<double, std::milli> drawTime{};
+        if (drawing) {
+            BeginDrawing();
+            ClearBackground(BLACK);
+            const auto drawStart = Clock::now();
+            world.draw();
+            drawTime = Clock::now() - drawStart;
+            EndDrawing();
+        }
+
+        if (frame < 0) continue;
+        allocations += allocationCount() - allocationsBefore;
+        updateTimes.push_back(updateTime.count());
+        drawTimes.push_back(drawTime.count());
+        frameTimes.push_back(updateTime.count() + drawTime.count());
+    }
+
+    const double allocationsPerFrame = static_cast<double>(allocations) / scene.frameCount;
+    std::printf("%-14s update p50 %.3f p99 %.3f  draw p50 %.3f p99 %.3f  allocs/frame %.2f  trigger events %d\n",
+        scene.name,
+        percentile(updateTimes, 0.50),
+        percentile(updateTimes, 0.99),
+        percentile(drawTimes, 0.50),
+        percentile(drawTimes, 0.99),
+        allocationCount() < 0 ? -1.0 : allocationsPerFrame,
+        triggerEvents);
+
+    results.add(scene.name, "update_p50_ms", percentile(updateTimes, 0.50));
+    results.add(scene.name, "update_p99_ms", percentile(updateTimes, 0.99));
+    if (drawing) {
+        results.add(scene.name, "draw_p50_ms", percentile(drawTimes, 0.50));
+        results.add(scene.name, "draw_p99_ms", percentile(drawTimes, 0.99));
+        results.add(scene.name, "frame_p99_ms", percentile(frameTimes, 0.99));
+    }
+    if (allocationCount() >= 0) {
+        results.add(scene.name, "allocations_per_frame", allocationsPerFrame);
+    }
+
+    world.unload();
+}
+
+// The regression suite: every scene in scenesPath, results written to resultsPath (if there is one)
+// and checked against baselinePath. Fails if anything's more than BENCH_TOLERANCE worse than its
+// baseline, or isn't in it, or there's no baseline at all. With saveBaseline this run becomes the
+// baseline instead.
+int runBenchSuite(const char* scenesPath, const char* baselinePath, const char* resultsPath, const bool saveBaseline) {
+    std::vector<BenchScene> scenes;
+    if (!loadBenchScenes(scenesPath, scenes)) return 1;
+
+    // Hidden window for draw to draw into, headless machines just don't get draw timings
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Box2D player bench");
+    const bool drawing = IsWindowReady();
+    if (drawing) {
+        SetTargetFPS(0);
+    }
+    else {
+        TraceLog(LOG_WARNING, "No window, World::draw won't be timed.");
+    }
+
+    std::printf("%d scenes, %d frames each after %d warmup, %s ruleset%s\n",
+        static_cast<int>(scenes.size()),
+        scenes.front().frameCount,
+        BENCH_WARMUP_FRAMES,
+        RULESET_NAME,
+        allocationCount() < 0 ? ", allocations aren't counted in this build" : "");
+
+    BenchResults results;
+    for (const auto& scene : scenes) {
+        runBenchScene(scene, drawing, results);
+    }
+
+    if (drawing) {
+        CloseWindow();
+    }
+
+    if (resultsPath != nullptr && !results.save(resultsPath)) return 1;
+
+    if (saveBaseline) {
+        if (!results.save(baselinePath)) return 1;
+        TraceLog(LOG_INFO, "Wrote baseline %s.", baselinePath);
+        return 0;
+    }
+
+    // Passing with nothing to compare against would pass every fresh checkout
+    if (!FileExists(baselinePath)) {
+        std::printf("No baseline at %s, nothing to check against. Save one with --save-baseline (the bench-baseline target).\n", baselinePath);
+        return 1;
+    }
+
+    BenchResults baseline;
+    if (!baseline.load(baselinePath)) return 1;
+
+    const int regressions = results.compare(baseline);
+    if (regressions > 0) {
+        std::printf("%d regressions or unchecked metrics against %s\n", regressions, baselinePath);
+        return 1;
+    }
+
+    std::printf("No regressions against %s\n", baselinePath);
+    return 0;
+}
+
+// Feeds a recorded input log back through a headless world step for step. Ends with the player's final
+// position and velocity as exact hex floats plus a hash of its position at every step, so two builds
+// can be checked for landing in exactly the same place.
+int runReplay(const char* logPath, const char* levelPath, const int workerCount) {
+    InputLog log;
+    if (!log.load(logPath)) return 1;
+
+    World world(levelPath, workerCount);
+    StepStats stats;
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+
+    for (std::size_t step = 0; step < log.size(); step++) {
+        stats.step(world, log.get(step));
+
+        const b2Vec2 position = b2Body_GetPosition(world.m_player.getBodyID());
+        uint32_t bits[2];
+        std::memcpy(bits, &position, sizeof(bits));
+        for (const uint32_t word : bits) {
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+    }
+
+    const b2Vec2 position = b2Body_GetPosition(world.m_player.getBodyID());
+    const b2Vec2 velocity = b2Body_GetLinearVelocity(world.m_player.getBodyID());
+
+    std::printf("replay %s, %d steps, workers %d, %s ruleset\n", logPath, static_cast<int>(log.size()), workerCount, RULESET_NAME);
+    stats.report(world);
+    std::printf("final        position %a %a  velocity %a %a\n", position.x, position.y, velocity.x, velocity.y);
+    std::printf("hash         %016llx\n", static_cast<unsigned long long>(hash));
+
+    world.unload();
+    return 0;
+}
+
+// The shared library build (BOX2D_PLAYER_LIBRARY in CMakeLists.txt) is everything but this
+#ifndef BOX2D_PLAYER_NO_MAIN
+
+// Windowed frame pacing, plus how old the input in each frame is by the time it's on screen. raylib's
+// own pacing polls input in EndDrawing and then sleeps out the rest of the frame, so the next frame
+// steps and draws with input that's most of a frame old. Low latency mode turns that around: sleep
+// first, until just before the frame is due with room for however long poll to present has been
+// taking, then poll, step and draw straight away. raylib's wait is off either way and this does it,
+// so both modes get measured the same way.
+class FramePacer {
+    // Keys the game checks with isKeyPressed, they get sampled at both polls same as jump and fire
+    static constexpr int WATCHED_KEY_COUNT = 3;
+    static constexpr int WATCHED_KEYS[WATCHED_KEY_COUNT] = {KEY_F1, KEY_F2, KEY_F3};
+
+    bool m_lowLatency;
+    double m_framePeriod; // Seconds, 0 for uncapped
+    double m_nextFrame{}; // When the next present is due, in GetTime seconds
+    double m_pollTime{}; // When the input the current frame is using was polled
+    double m_workEstimate{}; // Poll to present in seconds. Goes up right away, comes back down slowly
+    std::vector<double> m_latencies{}; // Milliseconds, ring of the last LATENCY_SAMPLES frames
+    std::size_t m_nextLatency{};
+    bool m_earlyPresses[WATCHED_KEY_COUNT]{}; // Which watched keys EndDrawing's poll saw go down
+
+    static void waitUntil(const double time) {
+        const double remaining = time - GetTime();
+        if (remaining > 0.0) {
+            WaitTime(remaining);
+        }
+    }
+
+    bool waitsFirst() const {
+        return m_lowLatency && m_framePeriod > 0.0;
+    }
+public:
+    // After InitWindow
+    FramePacer(const int targetFps, const bool lowLatency) :
+        m_lowLatency(lowLatency),
+        m_framePeriod(targetFps > 0 ? 1.0 / targetFps : 0.0)
+    {
+        SetTargetFPS(0);
+        m_latencies.reserve(LATENCY_SAMPLES);
+        m_pollTime = GetTime();
+        m_nextFrame = m_pollTime + m_framePeriod;
+    }
+
+    // Before anything reads input. The poll here ends whatever presses EndDrawing's poll saw, so they
+    // still count for this frame, through isKeyPressed for anything that isn't PlayerInput.
+    PlayerInput beginFrame() {
+        if (!waitsFirst()) return pollKeyboard();
+
+        const PlayerInput early = pollKeyboard();
+        for (int i = 0; i < WATCHED_KEY_COUNT; i++) {
+            m_earlyPresses[i] = IsKeyPressed(WATCHED_KEYS[i]);
+        }
+        waitUntil(m_nextFrame - m_workEstimate - LOW_LATENCY_MARGIN);
+        PollInputEvents();
+        m_pollTime = GetTime();
+
+        PlayerInput input = pollKeyboard();
+        input.jump = input.jump || early.jump;
+        input.fire = input.fire || early.fire;
+        return input;
+    }
+
+    // IsKeyPressed for this frame's input, either poll. After beginFrame, key has to be in WATCHED_KEYS
+    bool isKeyPressed(const int key) const {
+        for (int i = 0; i < WATCHED_KEY_COUNT; i++) {
+            if (WATCHED_KEYS[i] == key) return m_earlyPresses[i] || IsKeyPressed(key);
+        }
+
+        assert(false && "Assertion failed. Key isn't in FramePacer::WATCHED_KEYS.");
+        return IsKeyPressed(key);
+    }
+
+    // Right after EndDrawing, which is as close to present as raylib lets us get
+    void endFrame(Profiler& profiler) {
+        const double present = GetTime();
+        const double latency = present - m_pollTime;
+
+        if (m_latencies.size() < LATENCY_SAMPLES) {
+            m_latencies.push_back(latency * 1000.0);
+        }
+        else {
+            m_latencies[m_nextLatency] = latency * 1000.0;
+        }
+        m_nextLatency = (m_nextLatency + 1) % LATENCY_SAMPLES;
+        profiler.recordLatency(static_cast<float>(latency * 1000.0));
+
+        m_workEstimate = latency > m_workEstimate ? latency : m_workEstimate + (latency - m_workEstimate) * 0.05;
+
+        // EndDrawing just polled, that's what the next frame gets
+        if (!waitsFirst()) {
+            m_pollTime = present;
+            waitUntil(m_nextFrame);
+        }
+
+        // Fell behind, start over from now instead of rushing frames out to catch up
+        m_nextFrame += m_framePeriod;
+        if (m_nextFrame < GetTime()) {
+            m_nextFrame = GetTime() + m_framePeriod;
+        }
+    }
+
+    void report() const {
+        if (m_latencies.empty()) return;
+
+        TraceLog(
+            LOG_INFO,
+            "Input to present, %s pacing: mean %.2f ms, p50 %.2f ms, p99 %.2f ms over the last %d frames.",
+            m_lowLatency ? "low latency" : "default",
+            mean(m_latencies),
+            percentile(m_latencies, 0.5),
+            percentile(m_latencies, 0.99),
+            static_cast<int>(m_latencies.size()));
+    }
+};
+
+// Gets the windowed game's world and art ready without holding up any one frame for long, so there's
+// a loading screen that keeps drawing instead of a window that hangs. A worker parses the level and
+// decodes the atlas. Whatever has to be on the main thread gets done a LOAD_SLICE at a time: creating
+// the world, the first chunks' bodies (prepared on the level streamer's thread) and the texture upload.
+// Creating the world and the upload can't be split up, so those two frames can go over.
+class GameLoader {
+    using Clock = std::chrono::steady_clock;
+    enum class Stage { Reading, Bodies, Upload, Done };
+
+    int m_workerCount;
+    Stage m_stage{Stage::Reading};
+    std::thread m_worker{};
+    std::atomic<bool> m_read{}; // The worker's done with everything below, until then it's the worker's
+    Level m_level{};
+    Image m_atlasImage{};
+    double m_parseMs{};
+    double m_decodeMs{};
+    std::unique_ptr<World> m_world{};
+
+    // Main thread timings
+    Clock::time_point m_start{};
+    double m_worldMs{};
+    double m_bodiesMs{};
+    double m_uploadMs{};
+    double m_longestSliceMs{};
+    int m_frames{};
+
+    static double msSince(const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void read(const char* levelPath) {
+        const Clock::time_point start = Clock::now();
+        m_level = World::loadLevelOrDemo(levelPath);
+        m_parseMs = msSince(start);
+
+        const Clock::time_point decodeStart = Clock::now();
+        m_atlasImage = SpriteAtlas::decode();
+        m_decodeMs = msSince(decodeStart);
+
+        m_read.store(true, std::memory_order_release);
+    }
+
+    // As much of the current stage as fits before deadline. False if it has to wait for the next frame
+    bool advance(const Clock::time_point deadline) {
+        const Clock::time_point start = Clock::now();
+
+        switch (m_stage) {
+            case Stage::Reading:
+                if (!m_read.load(std::memory_order_acquire)) return false;
+                m_worker.join();
+                m_world = std::make_unique<World>(std::move(m_level), m_workerCount, true, true);
+                m_worldMs = msSince(start);
+                m_stage = Stage::Bodies;
+                return true;
+            case Stage::Bodies: {
+                const bool done = m_world->finishLoading(deadline);
+                m_bodiesMs += msSince(start);
+                if (!done) return false;
+                m_stage = Stage::Upload;
+                return true;
+            }
+            case Stage::Upload:
+                m_world->m_sprites.uploadAtlas(m_atlasImage);
+                m_atlasImage = Image{};
+                m_uploadMs = msSince(start);
+                m_stage = Stage::Done;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void report() const {
+        TraceLog(
+            LOG_INFO,
+            "Loaded in %.1f ms over %d frames. Worker: level %.1f ms, atlas decode %.1f ms. Main thread: world %.1f ms, "
+            "bodies %.1f ms, atlas upload %.1f ms, longest frame %.2f ms.",
+            msSince(m_start), m_frames, m_parseMs, m_decodeMs, m_worldMs, m_bodiesMs, m_uploadMs, m_longestSliceMs);
+    }
+public:
+    // After InitWindow. Null level path for the demo layout
+    GameLoader(const char* levelPath, const int workerCount) :
+        m_workerCount(workerCount),
+        m_start(Clock::now())
+    {
+        m_worker = std::thread(&GameLoader::read, this, levelPath);
+    }
+
+    GameLoader(const GameLoader&) = delete;
+    GameLoader& operator=(const GameLoader&) = delete;
+
+    // Fine to give up partway, say if the window gets closed on the loading screen
+    ~GameLoader() {
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+        if (m_atlasImage.data != nullptr) {
+            UnloadImage(m_atlasImage);
+        }
+        if (m_world != nullptr) {
+            m_world->unload();
+        }
+    }
+
+    // Once a frame until it's true, then takeWorld
+    bool update() {
+        if (m_stage == Stage::Done) return true;
+
+        const Clock::time_point start = Clock::now();
+        const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(LOAD_SLICE));
+        while (Clock::now() < deadline && advance(deadline)) {}
+
+        m_frames++;
+        m_longestSliceMs = std::max(m_longestSliceMs, msSince(start));
+
+        if (m_stage != Stage::Done) return false;
+        report();
+        return true;
+    }
+
+    // 0 to 1, for the loading screen. The worker's part doesn't report progress, it's quick
+    float getProgress() const {
+        switch (m_stage) {
+            case Stage::Reading: return 0.0f;
+            case Stage::Bodies: return 0.1f + 0.8f * m_world->getLoadProgress();
+            case Stage::Upload: return 0.9f;
+            default: return 1.0f;
+        }
+    }
+
+    const char* getStageName() const {
+        switch (m_stage) {
+            case Stage::Reading: return "Reading level";
+            case Stage::Bodies: return "Building level";
+            case Stage::Upload: return "Uploading art";
+            default: return "Done";
+        }
+    }
+
+    std::unique_ptr<World> takeWorld() {
+        assert(m_stage == Stage::Done && "Assertion failed. World taken before loading finished.");
+        return std::move(m_world);
+    }
+};
+
+// The loading screen hook, drawn every frame GameLoader isn't done. Screen space, between BeginDrawing
+// and EndDrawing
+void drawLoadingScreen(const GameLoader& loader) {
+    constexpr int barWidth = WINDOW_WIDTH / 2;
+    constexpr int barHeight = 12;
+    constexpr int x = (WINDOW_WIDTH - barWidth) / 2;
+    constexpr int y = WINDOW_HEIGHT / 2;
+
+    DrawText(loader.getStageName(), x, y - 25, 20, WHITE);
+    DrawRectangleLines(x, y, barWidth, barHeight, WHITE);
+    DrawRectangle(x, y, static_cast<int>(barWidth * loader.getProgress()), barHeight, WHITE);
+}
+
+// Box2DPlayer [--workers <count>] [--record <input log>] [--connect <host[:port]>] [--low-latency]
+//             [--tuning <tuning file>] [level file]
+// Box2DPlayer --server [port] [level file]
+// Box2DPlayer --convert <input level> <output level>
+// Box2DPlayer --bench-threads [box count] [step count]
+// Box2DPlayer --bench [platform count] [player count] [step count] [worker count]
+// Box2DPlayer --bench-spawn [spawns per step] [step count]
+// Box2DPlayer --bench-ground [character count] [step count]
+// Box2DPlayer --bench-snapshot [player count] [step count] [rollback steps]
+// Box2DPlayer --bench-net [client count] [step count]
+// Box2DPlayer --bench-batch [world count] [step count] [max threads]
+// Box2DPlayer --bench-suite <scene file> <baseline file> [results file] [--save-baseline]
+// Box2DPlayer --replay <input log> [level file]
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--convert") == 0) {
+        if (argc != 4) {
+            TraceLog(LOG_ERROR, "Usage: %s --convert <input level> <output level>", argv[0]);
+            return 1;
+        }
+
+        return convertLevel(argv[2], argv[3]);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench-threads") == 0) {
+        const int boxCount = argc > 2 ? std::atoi(argv[2]) : 4000;
+        const int stepCount = argc > 3 ? std::atoi(argv[3]) : 300;
+        return runThreadBenchmark(std::max(1, boxCount), std::max(1, stepCount));
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+        const int platformCount = argc > 2 ? std::atoi(argv[2]) : 1000;
+        const int playerCount = argc > 3 ? std::atoi(argv[3]) : 100;
+        const int stepCount = argc > 4 ? std::atoi(argv[4]) : 600;
+        const int workerCount = argc > 5 ? std::atoi(argv[5]) : defaultWorkerCount();
+        return runBenchmark(std::max(0, platformCount), std::max(0, playerCount - 1), std::max(1, stepCount), workerCount);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench-spawn") == 0) {
+        const int perStep = argc > 2 ? std::atoi(argv[2]) : 50;
+        const int stepCount = argc > 3 ? std::atoi(argv[3]) : 600;
+        return runSpawnBenchmark(std::max(1, perStep), std::max(1, stepCount), defaultWorkerCount());
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench-ground") == 0) {
+        const int characterCount = argc > 2 ? std::atoi(argv[2]) : 1000;
+        const int stepCount = argc > 3 ? std::atoi(argv[3]) : 600;
+        return runGroundBenchmark(std::max(1, characterCount), std::max(1, stepCount), defaultWorkerCount());
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench-snapshot") == 0) {
+        const int playerCount = argc > 2 ? std::atoi(argv[2]) : 100;
+        const int stepCount = argc > 3 ? std::atoi(argv[3]) : 600;
+        const int rollbackSteps = argc > 4 ? std::atoi(argv[4]) : 8;
+        return runSnapshotBenchmark(std::max(0, playerCount - 1), std::max(1, stepCount), std::max(1, rollbackSteps), defaultWorkerCount());
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench-net") == 0) {
+        const int clientCount = argc > 2 ? std::atoi(argv[2]) : 256;
+        const int stepCount = argc > 3 ? std::atoi(argv[3]) : 600;
+        return runNetBenchmark(std::min(std::max(1, clientCount), NET_MAX_CONNECTIONS), std::max(1, stepCount), defaultWorkerCount());
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench-batch") == 0) {
+        const int worldCount = argc > 2 ? std::atoi(argv[2]) : MAX_BATCH_WORLDS;
+        const int stepCount = argc > 3 ? std::atoi(argv[3]) : 600;
+        const int maxThreads = argc > 4 ? std::atoi(argv[4]) : defaultWorkerCount();
+        return runBatchBenchmark(std::min(std::max(1, worldCount), MAX_BATCH_WORLDS), std::max(1, stepCount), std::max(1, maxThreads));
+    }
+
+    if (argc > 3 && std::strcmp(argv[1], "--bench-suite") == 0) {
+        const bool saveBaseline = std::strcmp(argv[argc - 1], "--save-baseline") == 0;
+        const char* resultsPath = argc > 4 && !(saveBaseline && argc == 5) ? argv[4] : nullptr;
+        return runBenchSuite(argv[2], argv[3], resultsPath, saveBaseline);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--server") == 0) {
+        const uint16_t port = argc > 2 ? static_cast<uint16_t>(std::atoi(argv[2])) : NET_DEFAULT_PORT;
+        return runServer(port, argc > 3 ? argv[3] : nullptr, defaultWorkerCount());
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--replay") == 0) {
+        if (argc < 3) {
+            TraceLog(LOG_ERROR, "Usage: %s --replay <input log> [level file]", argv[0]);
+            return 1;
+        }
+
+        return runReplay(argv[2], argc > 3 ? argv[3] : nullptr, defaultWorkerCount());
+    }
+
+    const char* levelPath = nullptr;
+    const char* recordPath = nullptr;
+    const char* serverAddress = nullptr;
+    const char* tuningPath = nullptr;
+    int workerCount = defaultWorkerCount();
+    bool lowLatency = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workerCount = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            serverAddress = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--low-latency") == 0) {
+            lowLatency = true;
+        }
+        else if (std::strcmp(argv[i], "--tuning") == 0 && i + 1 < argc) {
+            tuningPath = argv[++i];
+        }
+        else {
+            levelPath = argv[i];
+        }
+    }
+
+    std::unique_ptr<NetClient> client;
+    if (serverAddress != nullptr) {
+        client = std::make_unique<NetClient>();
+        if (!client->connect(serverAddress)) return 1;
+
+        // Resimulated steps would land in the log twice
+        if (recordPath != nullptr) {
+            TraceLog(LOG_WARNING, "Can't record while connected to a server, --record ignored.");
+            recordPath = nullptr;
+        }
+
+        // The server simulates with the ruleset's, prediction would be wrong every step
+        if (tuningPath != nullptr) {
+            TraceLog(LOG_WARNING, "Can't tune while connected to a server, --tuning ignored.");
+            tuningPath = nullptr;
+        }
+    }
+
+    if (recordPath != nullptr && tuningPath != nullptr) {
+        TraceLog(LOG_WARNING, "Replays use the ruleset's tuning, this recording won't play back the same.");
+    }
+
+    std::unique_ptr<TuningWatcher> tuningWatcher;
+    MovementTuning tuning;
+    if (tuningPath != nullptr) {
+        tuningWatcher = std::make_unique<TuningWatcher>(tuningPath);
+    }
+
+    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Box2D player movement demo");
+
+    // raylib paces the loading screen, FramePacer takes over once the game starts
+    SetTargetFPS(TARGET_FPS);
+    GameLoader loader(levelPath, workerCount);
+    while (!loader.update()) {
+        if (WindowShouldClose()) return 0;
+
+        BeginDrawing();
+        ClearBackground(BLACK);
+        drawLoadingScreen(loader);
+        EndDrawing();
+    }
+
+    const std::unique_ptr<World> loadedWorld = loader.takeWorld();
+    World& world = *loadedWorld;
+    FramePacer pacer(TARGET_FPS, lowLatency);
+
+    InputLog recording;
+    if (recordPath != nullptr) {
+        world.m_recording = &recording;
+    }
+
+    while (!WindowShouldClose()) {
+        // Low latency pacing polls again in here, so the keys get checked after, through the pacer
+        const PlayerInput input = pacer.beginFrame();
+
+        #ifdef ENABLE_DEBUG
+            if (pacer.isKeyPressed(KEY_F1)) {
+                world.m_debugDraw.toggle();
+            }
+        #endif
+
+        if (pacer.isKeyPressed(KEY_F2)) {
+            world.m_profiler.toggleHud();
+        }
+        if (pacer.isKeyPressed(KEY_F3)) {
+            world.m_profiler.saveTrace(TRACE_PATH);
+        }
+
+        if (tuningWatcher != nullptr && tuningWatcher->poll(GetTime(), tuning)) {
+            world.setTuning(tuning);
+            TraceLog(LOG_INFO, "Applied tuning from %s.", tuningPath);
+        }
+
+        if (client != nullptr) {
+            client->update(world, GetFrameTime(), input);
+        }
+        else {
+            world.update(GetFrameTime(), input);
+        }
+
+        BeginDrawing();
+        ClearBackground(BLACK);
+        world.draw([&client, &world](SpriteBatch& sprites) {
+            if (client != nullptr) {
+                client->draw(world, sprites);
+            }
+        });
+        EndDrawing();
+        pacer.endFrame(world.m_profiler);
+    }
+
+    pacer.report();
+
+    world.unload();
+
+    if (recordPath != nullptr && !recording.save(recordPath)) {
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif